@@ -0,0 +1,347 @@
+/*
+  ==============================================================================
+
+    Headless micro-benchmarks for the lifetime primitives of the Macros
+    project: weak references, leak detectors, delayed callbacks and object
+    churn.
+
+    Usage: Benchmarks [--filter text] [--samples n] [--json file]
+
+    Results are printed as they are measured; --json also writes them to a
+    file (see MicroBenchmark.h for the format). Build the Release
+    configuration for numbers that mean anything.
+
+    Tracing is compiled in (ENABLE_TRACING), so that the cost of TRACE_SCOPE
+    can be measured; the churn benchmarks include their trace scopes too.
+
+  ==============================================================================
+*/
+
+#define ENABLE_TRACING 1
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../Source/MainComponent.h"
+#include "../../Source/MicroBenchmark.h"
+#include "../../Source/SelfDestructingObject.h"
+#include "../../Source/TimingWheel.h"
+#include "../../Source/Trace.h"
+
+namespace
+{
+    /** The number of operations each benchmarked call performs. */
+    constexpr int batchSize = 1000;
+
+    //==============================================================================
+    void runWeakReferenceBenchmarks (MicroBenchmark& benchmark)
+    {
+        std::unique_ptr<WeakReferenceableObject[]> objects (new WeakReferenceableObject[batchSize]);
+        std::vector<WeakReference<WeakReferenceableObject>> references;
+
+        for (int i = 0; i < batchSize; ++i)
+            references.emplace_back (&objects[i]);
+
+        benchmark.run ("WeakReference create (first reference)", batchSize, []
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                WeakReferenceableObject object;
+                WeakReference<WeakReferenceableObject> reference (&object);
+                MicroBenchmark::keep (reference.get ());
+            }
+        });
+
+        benchmark.run ("WeakReference create", batchSize, [&]
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                WeakReference<WeakReferenceableObject> reference (&objects[i]);
+                MicroBenchmark::keep (reference.get ());
+            }
+        });
+
+        benchmark.run ("WeakReference copy", batchSize, [&]
+        {
+            for (auto& reference : references)
+            {
+                auto copy = reference;
+                MicroBenchmark::keep (copy.get ());
+            }
+        });
+
+        benchmark.run ("WeakReference check", batchSize, [&]
+        {
+            int numAlive = 0;
+
+            for (auto& reference : references)
+                if (reference != nullptr)
+                    ++numAlive;
+
+            MicroBenchmark::keep (numAlive);
+        });
+
+        benchmark.run ("WeakReference deref", batchSize, [&]
+        {
+            for (auto& reference : references)
+                if (auto* object = reference.get ())
+                    MicroBenchmark::keep (object);
+        });
+
+        benchmark.run ("WeakReferenceExample ()", 1, []
+        {
+            WeakReferenceExample ();
+        });
+    }
+
+    //==============================================================================
+    void runMacroBenchmarks (MicroBenchmark& benchmark)
+    {
+        std::vector<int> values ((size_t) batchSize);
+        LifetimeRandom random (1234);
+        random.fillInts (values.data (), batchSize, 1 << 20);
+
+        benchmark.run ("MAX macro", batchSize, [&]
+        {
+            auto largest = values[0];
+
+            for (auto value : values)
+                largest = MAX (largest, value);
+
+            MicroBenchmark::keep (largest);
+        });
+
+        benchmark.run ("jmax", batchSize, [&]
+        {
+            auto largest = values[0];
+
+            for (auto value : values)
+                largest = jmax (largest, value);
+
+            MicroBenchmark::keep (largest);
+        });
+    }
+
+    //==============================================================================
+    // PluginName is a constant now, so there is nothing left to do for it during static initialisation
+    static_assert (PluginName.length () > 0 && PluginName[0] != 0, "PluginName must be a compile time constant");
+
+    /** What the old static String PluginName cost at startup, against using the FixedString that replaced it. */
+    void runStartupBenchmarks (MicroBenchmark& benchmark)
+    {
+        benchmark.run ("static String PluginName (construct + use)", batchSize, []
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                const String name { IF_EXTENDED ("Extended Plugin", "Normal Plugin") };
+                MicroBenchmark::keep (name.length ());
+            }
+        });
+
+        benchmark.run ("FixedString PluginName (as StringRef + use)", batchSize, []
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                StringRef name = PluginName;
+                MicroBenchmark::keep (name.length ());
+            }
+        });
+    }
+
+    //==============================================================================
+    /** A scope should cost about 20 ns. The recorder is cleared after each batch, so no event is ever dropped (which would be cheaper). */
+    void runTraceBenchmarks (MicroBenchmark& benchmark)
+    {
+        auto& recorder = TraceRecorder::getInstance ();
+
+        benchmark.run ("TRACE_SCOPE", batchSize, [&]
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                TRACE_SCOPE ("benchmark scope");
+                MicroBenchmark::keep (i);
+            }
+
+            recorder.clear ();
+        });
+
+        benchmark.run ("TRACE_COUNTER", batchSize, [&]
+        {
+            for (int i = 0; i < batchSize; ++i)
+                TRACE_COUNTER ("benchmark counter", i);
+
+            recorder.clear ();
+        });
+    }
+
+    //==============================================================================
+    /** No detector, but a constructor and destructor with side effects, so the loop can't be removed. */
+    struct UndetectedObject
+    {
+        UndetectedObject () noexcept    { MicroBenchmark::keep (1); }
+        ~UndetectedObject ()            { MicroBenchmark::keep (-1); }
+    };
+
+    // the detectors are members rather than macros, so that they also count in builds without JUCE_CHECK_MEMORY_LEAKS
+    struct JuceDetectedObject  : public UndetectedObject
+    {
+        static const char* getLeakedObjectClassName () noexcept { return "JuceDetectedObject"; }
+        LeakedObjectDetector<JuceDetectedObject> detector;
+    };
+
+    struct ShardedDetectedObject  : public UndetectedObject
+    {
+        static const char* getLeakedObjectClassName () noexcept { return "ShardedDetectedObject"; }
+        ShardedLeakedObjectDetector<ShardedDetectedObject> detector;
+    };
+
+    template <typename ObjectType>
+    void runConstructionBenchmark (MicroBenchmark& benchmark, const String& name)
+    {
+        benchmark.run (name, batchSize, []
+        {
+            for (int i = 0; i < batchSize; ++i)
+            {
+                ObjectType object;
+                MicroBenchmark::keep (&object);
+            }
+        });
+    }
+
+    void runLeakDetectorBenchmarks (MicroBenchmark& benchmark)
+    {
+        runConstructionBenchmark<UndetectedObject> (benchmark, "construct, no leak detector");
+        runConstructionBenchmark<JuceDetectedObject> (benchmark, "construct, LeakedObjectDetector");
+        runConstructionBenchmark<ShardedDetectedObject> (benchmark, "construct, ShardedLeakedObjectDetector");
+    }
+
+    //==============================================================================
+    void runDelayedCallbackBenchmarks (MicroBenchmark& benchmark)
+    {
+        VirtualLifetimeClock clock;
+        LifetimeEnvironment::setClock (&clock);
+        auto& scheduler = LifetimeScheduler::getInstance ();
+
+        benchmark.run ("LifetimeScheduler callAfterDelay + fire", batchSize, [&]
+        {
+            int fired = 0;
+
+            for (int i = 0; i < batchSize; ++i)
+                LifetimeScheduler::callAfterDelay (i * 3, [&fired] { ++fired; });
+
+            clock.advance (3 * batchSize);
+            scheduler.update ();
+            MicroBenchmark::keep (fired);
+        });
+
+        benchmark.run ("LifetimeScheduler callAfterDelay + cancel", batchSize, [&]
+        {
+            for (int i = 0; i < batchSize; ++i)
+                LifetimeScheduler::cancel (LifetimeScheduler::callAfterDelay (i * 3, [] {}));
+        });
+
+        TimingWheel wheel;
+        int64 now = 0;
+
+        benchmark.run ("TimingWheel schedule + expire", batchSize, [&]
+        {
+            int fired = 0;
+
+            for (int i = 0; i < batchSize; ++i)
+                wheel.schedule (now + i * 3, [&fired] { ++fired; });
+
+            now += 3 * batchSize;
+            wheel.advanceTo (now);
+            MicroBenchmark::keep (fired);
+        });
+
+        LifetimeEnvironment::setClock (nullptr);
+    }
+
+    //==============================================================================
+    void runObjectChurnBenchmarks (MicroBenchmark& benchmark)
+    {
+        VirtualLifetimeClock clock;
+        LifetimeEnvironment::setClock (&clock);
+        LifetimeEnvironment::setSeed (1234);
+
+        auto& scheduler = LifetimeScheduler::getInstance ();
+        auto& deletionQueue = DeferredDeletionQueue::getInstance ();
+        auto previousMode = SelfDestructingObject::getLifetimeMode ();
+
+        for (auto mode : { SelfDestructingObject::LifetimeMode::deleteOnExpiry, SelfDestructingObject::LifetimeMode::pooled })
+        {
+            SelfDestructingObject::setLifetimeMode (mode);
+
+            auto name = String ("SelfDestructingObject lifetime")
+                      + (mode == SelfDestructingObject::LifetimeMode::pooled ? " (pooled)" : " (new/delete)");
+
+            benchmark.run (name, batchSize, [&]
+            {
+                for (int i = 0; i < batchSize; ++i)
+                    SelfDestructingObject::create ();
+
+                clock.advance (LifetimeEnvironment::getLifetimeDistribution ().getMaxMilliseconds ());
+                scheduler.update ();
+                deletionQueue.flush ();
+            });
+        }
+
+        ObjectPool<SelfDestructingObject>::getInstance ().clear ();
+        SelfDestructingObject::setLifetimeMode (previousMode);
+        LifetimeEnvironment::setClock (nullptr);
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    ArgumentList arguments (argc, argv);
+
+    if (arguments.containsOption ("--help|-h"))
+    {
+        std::cout << "Usage: " << arguments.executableName << " [--filter text] [--samples n] [--json file]" << std::endl;
+        return 0;
+    }
+
+    // the scheduler and the deletion queue are Timers, so they need a message manager
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    MicroBenchmark::Options options;
+
+    if (arguments.containsOption ("--samples"))
+        options.numSamples = jmax (1, MicroBenchmark::getOptionValue (arguments, "--samples").getIntValue ());
+
+    MicroBenchmark benchmark (options);
+    benchmark.setFilter (MicroBenchmark::getOptionValue (arguments, "--filter"));
+    benchmark.onResult = [] (const MicroBenchmark::Result& result) { std::cout << MicroBenchmark::formatResult (result) << std::endl; };
+
+    if (MicroBenchmark::isDebugBuild ())
+        std::cout << "Note: this is a debug build" << std::endl;
+
+    runWeakReferenceBenchmarks (benchmark);
+    runMacroBenchmarks (benchmark);
+    runStartupBenchmarks (benchmark);
+    runTraceBenchmarks (benchmark);
+    runLeakDetectorBenchmarks (benchmark);
+    runDelayedCallbackBenchmarks (benchmark);
+    runObjectChurnBenchmarks (benchmark);
+
+    TraceRecorder::getInstance ().clear ();
+
+    AsyncLog::getInstance ().shutdown ();
+
+    auto jsonPath = MicroBenchmark::getOptionValue (arguments, "--json");
+
+    if (jsonPath.isNotEmpty ())
+    {
+        auto file = File::getCurrentWorkingDirectory ().getChildFile (jsonPath);
+
+        if (! file.replaceWithText (benchmark.toJson ()))
+        {
+            std::cerr << "Couldn't write " << file.getFullPathName () << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
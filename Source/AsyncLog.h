@@ -0,0 +1,400 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Asynchronous Logging
+ *
+ * DBG formats a juce::String and writes it out right away, and it disappears
+ * completely in release builds. The LOG_xxx macros below are cheap enough to
+ * stay in hot paths of release builds:
+ *
+ * LOG_INFO ("Name: {}", object->getName ());
+ * LOG_WARNING ("{} objects still alive after {} ms", numAlive, elapsed);
+ *
+ * - the call only copies the arguments into a fixed size record in a ring
+ *   buffer owned by the calling thread (no locks, no allocation)
+ * - a background thread collects the records from all threads, formats them
+ *   (replacing each {} with the next argument) and writes them to the sink
+ * - levels below ASYNC_LOG_MIN_LEVEL are removed at compile time, just like
+ *   DBG is in release builds
+ *
+ * If a thread logs faster than the flusher can keep up with, records are
+ * dropped (and counted) rather than blocking the caller. Strings longer than
+ * the record's text space are truncated.
+ *
+ * Call AsyncLog::getInstance ().shutdown () before the application quits to
+ * write out whatever is still buffered.
+ */
+
+#define ASYNC_LOG_LEVEL_TRACE    0
+#define ASYNC_LOG_LEVEL_DEBUG    1
+#define ASYNC_LOG_LEVEL_INFO     2
+#define ASYNC_LOG_LEVEL_WARNING  3
+#define ASYNC_LOG_LEVEL_ERROR    4
+
+#ifndef ASYNC_LOG_MIN_LEVEL
+ #if JUCE_DEBUG
+  #define ASYNC_LOG_MIN_LEVEL ASYNC_LOG_LEVEL_TRACE
+ #else
+  #define ASYNC_LOG_MIN_LEVEL ASYNC_LOG_LEVEL_INFO
+ #endif
+#endif
+
+#define ASYNC_LOG(level, ...) \
+    do { if constexpr ((level) >= ASYNC_LOG_MIN_LEVEL) AsyncLog::getInstance ().write ((level), __FILE__, __LINE__, __VA_ARGS__); } while (false)
+
+#define LOG_TRACE(...)    ASYNC_LOG (ASYNC_LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_DEBUG(...)    ASYNC_LOG (ASYNC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)     ASYNC_LOG (ASYNC_LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...)  ASYNC_LOG (ASYNC_LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)    ASYNC_LOG (ASYNC_LOG_LEVEL_ERROR, __VA_ARGS__)
+
+
+class AsyncLog  : private Thread
+{
+public:
+    using Sink = std::function<void (const String&)>;
+
+    static AsyncLog& getInstance ()
+    {
+        static AsyncLog log;
+        return log;
+    }
+
+    ~AsyncLog () override
+    {
+        shutdown ();
+    }
+
+    /** Called by the LOG_xxx macros. The format string must be a literal (only its pointer is stored). */
+    template <typename... Arguments>
+    void write (int level, const char* file, int line, const char* format, const Arguments&... arguments)
+    {
+        static_assert (sizeof... (Arguments) <= maxArguments, "Too many arguments for a log record");
+
+        auto& buffer = getThreadBuffer ();
+        auto* record = buffer.beginWrite ();
+
+        if (record == nullptr)
+        {
+            buffer.numDropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        record->time = Time::getHighResolutionTicks ();
+        record->file = file;
+        record->format = format;
+        record->line = line;
+        record->level = (uint8) level;
+        record->numArguments = 0;
+        record->textUsed = 0;
+
+        (record->add (arguments), ...);
+
+        buffer.endWrite ();
+        ensureRunning ();
+    }
+
+    /** Replaces where formatted lines go. By default they go to Logger::outputDebugString. */
+    void setSink (Sink newSink)
+    {
+        const std::lock_guard<std::mutex> lock (sinkMutex);
+        sink = std::move (newSink);
+    }
+
+    /** Formats and writes everything that has been logged so far. */
+    void flush ()
+    {
+        const std::lock_guard<std::mutex> lock (flushMutex);
+
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        {
+            const std::lock_guard<std::mutex> registryLock (registryMutex);
+            buffers = threadBuffers;
+        }
+
+        std::vector<std::pair<Record, int>> records;
+
+        for (auto& buffer : buffers)
+            buffer->drain ([&records, &buffer] (const Record& record) { records.emplace_back (record, buffer->threadIndex); });
+
+        // records from different threads are interleaved by time
+        std::stable_sort (records.begin (), records.end (), [] (const auto& a, const auto& b) { return a.first.time < b.first.time; });
+
+        int64 dropped = 0;
+
+        for (auto& buffer : buffers)
+            dropped += buffer->numDropped.exchange (0, std::memory_order_relaxed);
+
+        const std::lock_guard<std::mutex> sinkLock (sinkMutex);
+
+        for (auto& [record, threadIndex] : records)
+            sink (formatRecord (record, threadIndex));
+
+        if (dropped > 0)
+            sink ("[WARNING] async log dropped " + String (dropped) + " record(s)");
+
+        removeExitedThreads ();
+    }
+
+    /** Stops the background thread after writing out everything that's buffered. */
+    void shutdown ()
+    {
+        stopThread (1000);
+        flush ();
+    }
+
+    static constexpr int maxArguments = 6;
+    static constexpr int maxTextBytes = 64;
+    static constexpr int recordsPerThread = 1024;
+    static constexpr int flushIntervalMs = 20;
+
+private:
+    AsyncLog () : Thread ("Async Log Flusher") {}
+
+    struct Record
+    {
+        enum class Type : uint8 { signedInteger, unsignedInteger, floatingPoint, boolean, text, pointer };
+
+        struct Argument
+        {
+            Type type;
+
+            union
+            {
+                int64 signedValue;
+                uint64 unsignedValue;
+                double doubleValue;
+                const void* pointerValue;
+                struct { uint16 offset, length; } text;
+            };
+        };
+
+        template <typename ValueType>
+        void add (const ValueType& value)
+        {
+            auto& argument = arguments[numArguments++];
+
+            if constexpr (std::is_same_v<ValueType, bool>)
+            {
+                argument.type = Record::Type::boolean;
+                argument.unsignedValue = value ? 1 : 0;
+            }
+            else if constexpr (std::is_integral_v<ValueType> && std::is_signed_v<ValueType>)
+            {
+                argument.type = Record::Type::signedInteger;
+                argument.signedValue = (int64) value;
+            }
+            else if constexpr (std::is_integral_v<ValueType> || std::is_enum_v<ValueType>)
+            {
+                argument.type = Record::Type::unsignedInteger;
+                argument.unsignedValue = (uint64) value;
+            }
+            else if constexpr (std::is_floating_point_v<ValueType>)
+            {
+                argument.type = Record::Type::floatingPoint;
+                argument.doubleValue = (double) value;
+            }
+            else if constexpr (std::is_convertible_v<const ValueType&, const char*>)
+            {
+                const char* chars = value;
+
+                if (chars == nullptr)
+                    chars = "(null)";
+
+                addText (argument, chars, std::strlen (chars));
+            }
+            else if constexpr (std::is_same_v<ValueType, String>)
+            {
+                addText (argument, value.toRawUTF8 (), value.getNumBytesAsUTF8 ());
+            }
+            else if constexpr (std::is_pointer_v<ValueType>)
+            {
+                argument.type = Record::Type::pointer;
+                argument.pointerValue = (const void*) value;
+            }
+            else
+            {
+                // anything else goes through a temporary String, which allocates
+                auto asString = String (value);
+                addText (argument, asString.toRawUTF8 (), asString.getNumBytesAsUTF8 ());
+            }
+        }
+
+        void addText (Argument& argument, const char* data, size_t numBytes) noexcept
+        {
+            auto length = (uint16) jmin (numBytes, (size_t) (maxTextBytes - textUsed));
+
+            // when truncating, don't cut a multi-byte UTF-8 sequence in half
+            if (length < numBytes)
+                while (length > 0 && (((uint8) data[length]) & 0xc0) == 0x80)
+                    --length;
+
+            argument.type = Record::Type::text;
+            argument.text.offset = textUsed;
+            argument.text.length = length;
+
+            std::memcpy (text + textUsed, data, length);
+            textUsed = (uint8) (textUsed + length);
+        }
+
+        int64 time;
+        const char* file;
+        const char* format;
+        int line;
+        uint8 level;
+        uint8 numArguments;
+        uint8 textUsed;
+        Argument arguments[maxArguments];
+        char text[maxTextBytes];
+    };
+
+    /** Single producer (the owning thread), single consumer (the flusher). */
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer (int index) : threadIndex (index) {}
+
+        Record* beginWrite () noexcept
+        {
+            auto tail = writeIndex.load (std::memory_order_relaxed);
+
+            if (tail - readIndex.load (std::memory_order_acquire) >= (uint32) recordsPerThread)
+                return nullptr;
+
+            return &records[tail & (recordsPerThread - 1)];
+        }
+
+        void endWrite () noexcept
+        {
+            writeIndex.store (writeIndex.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        template <typename Callback>
+        void drain (Callback&& callback)
+        {
+            auto head = readIndex.load (std::memory_order_relaxed);
+            auto tail = writeIndex.load (std::memory_order_acquire);
+
+            for (; head != tail; ++head)
+                callback (records[head & (recordsPerThread - 1)]);
+
+            readIndex.store (head, std::memory_order_release);
+        }
+
+        Record records[recordsPerThread];
+        std::atomic<uint32> writeIndex { 0 }, readIndex { 0 };
+        std::atomic<int64> numDropped { 0 };
+        std::atomic<bool> ownerExited { false };
+        const int threadIndex;
+    };
+
+    static_assert (isPowerOfTwo (recordsPerThread), "recordsPerThread must be a power of two");
+
+    /** Registers the thread's buffer on first use and flags it when the thread ends. */
+    struct ThreadBufferHolder
+    {
+        ThreadBufferHolder ()
+        {
+            auto& log = getInstance ();
+            const std::lock_guard<std::mutex> lock (log.registryMutex);
+
+            buffer = std::make_shared<ThreadBuffer> (log.nextThreadIndex++);
+            log.threadBuffers.push_back (buffer);
+        }
+
+        ~ThreadBufferHolder ()
+        {
+            buffer->ownerExited = true;
+        }
+
+        std::shared_ptr<ThreadBuffer> buffer;
+    };
+
+    static ThreadBuffer& getThreadBuffer ()
+    {
+        thread_local ThreadBufferHolder holder;
+        return *holder.buffer;
+    }
+
+    void ensureRunning ()
+    {
+        if (! started.load (std::memory_order_relaxed) && ! started.exchange (true))
+            startThread ();
+    }
+
+    void run () override
+    {
+        while (! threadShouldExit ())
+        {
+            wait (flushIntervalMs);
+            flush ();
+        }
+    }
+
+    void removeExitedThreads ()
+    {
+        const std::lock_guard<std::mutex> lock (registryMutex);
+
+        threadBuffers.erase (std::remove_if (threadBuffers.begin (), threadBuffers.end (), [] (const auto& buffer)
+        {
+            return buffer->ownerExited.load ()
+                && buffer->readIndex.load () == buffer->writeIndex.load ();
+        }), threadBuffers.end ());
+    }
+
+    String formatRecord (const Record& record, int threadIndex) const
+    {
+        static const char* const levelNames[] = { "TRACE", "DEBUG", "INFO", "WARNING", "ERROR" };
+
+        String line;
+        line << "[" << levelNames[jlimit (0, 4, (int) record.level)] << "] "
+             << String (Time::highResolutionTicksToSeconds (record.time - startTime) * 1000.0, 3) << " ms "
+             << "(thread " << threadIndex << ") ";
+
+        int argumentIndex = 0;
+
+        for (auto* c = record.format; *c != 0; ++c)
+        {
+            if (c[0] == '{' && c[1] == '}' && argumentIndex < record.numArguments)
+            {
+                line << formatArgument (record, record.arguments[argumentIndex++]);
+                ++c;
+            }
+            else
+            {
+                line += *c;
+            }
+        }
+
+        if (record.level >= ASYNC_LOG_LEVEL_WARNING)
+            line << " (" << String (record.file).fromLastOccurrenceOf ("/", false, false).fromLastOccurrenceOf ("\\", false, false) << ":" << record.line << ")";
+
+        return line;
+    }
+
+    static String formatArgument (const Record& record, const Record::Argument& argument)
+    {
+        switch (argument.type)
+        {
+            case Record::Type::signedInteger:    return String (argument.signedValue);
+            case Record::Type::unsignedInteger:  return String (argument.unsignedValue);
+            case Record::Type::floatingPoint:    return String (argument.doubleValue);
+            case Record::Type::boolean:          return argument.unsignedValue != 0 ? "true" : "false";
+            case Record::Type::pointer:          return "0x" + String::toHexString ((pointer_sized_int) argument.pointerValue);
+            case Record::Type::text:             return String::fromUTF8 (record.text + argument.text.offset, argument.text.length);
+        }
+
+        return {};
+    }
+
+    std::mutex registryMutex, flushMutex, sinkMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers;
+    int nextThreadIndex = 0;
+    std::atomic<bool> started { false };
+    const int64 startTime = Time::getHighResolutionTicks ();
+    Sink sink = [] (const String& line) { Logger::outputDebugString (line); };
+
+    JUCE_DECLARE_NON_COPYABLE (AsyncLog)
+};
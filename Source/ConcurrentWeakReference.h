@@ -0,0 +1,412 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Concurrent Weak References
+ *
+ * The usual `if (weak) weak->doSomething ();` is only safe on the thread that
+ * deletes the object: another thread can pass the check and then lose the
+ * race against `delete`. A ConcurrentWeakReference closes that gap with
+ * hazard pointers:
+ *
+ * - lock () publishes the object pointer in a per-thread hazard slot and
+ *   returns a Pin. While the Pin exists the object can't be destroyed.
+ * - the owner doesn't delete the object directly but hands it to retire (),
+ *   which makes all further lock () calls fail and defers the actual delete
+ *   until no hazard slot contains the object anymore.
+ *
+ * Readers never take a lock: pinning is two atomic stores and a load. Only
+ * retire () serialises on a mutex.
+ *
+ * class SharedObject
+ * {
+ *     DECLARE_CONCURRENT_WEAK_REFERENCEABLE (SharedObject)
+ * };
+ *
+ * // any thread
+ * if (auto pinned = weak.lock ())
+ *     pinned->doSomething ();
+ *
+ * // owning thread
+ * ConcurrentWeakReference<SharedObject>::retire (object);
+ */
+
+class HazardPointers
+{
+public:
+    struct Record
+    {
+        std::atomic<const void*> pointer { nullptr };
+        std::atomic<bool> active { false };
+        Record* next = nullptr;
+    };
+
+    static HazardPointers& getInstance ()
+    {
+        static HazardPointers domain;
+        return domain;
+    }
+
+    ~HazardPointers ()
+    {
+        // no reader can be left at static destruction time
+        for (auto& retired : retiredObjects)
+            retired.deleter (retired.object);
+
+        for (auto* record = head.load (); record != nullptr;)
+            delete std::exchange (record, record->next);
+    }
+
+    /** Returns a hazard slot owned by the calling thread. Lock-free. */
+    Record* acquire ()
+    {
+        return getThreadRecords ().acquire ();
+    }
+
+    void release (Record* record) noexcept
+    {
+        getThreadRecords ().release (record);
+    }
+
+    /** Makes the object pending for deletion. It is deleted once no hazard slot refers to it. */
+    void retire (void* object, void (*deleter) (void*))
+    {
+        std::vector<RetiredObject> reclaimable;
+
+        {
+            const std::lock_guard<std::mutex> lock (retireMutex);
+            retiredObjects.push_back ({ object, deleter });
+
+            if (retiredObjects.size () >= scanThreshold ())
+                reclaimable = scanLocked ();
+        }
+
+        for (auto& retired : reclaimable)
+            retired.deleter (retired.object);
+    }
+
+    /** Deletes every retired object that is not pinned anymore. */
+    void collect ()
+    {
+        std::vector<RetiredObject> reclaimable;
+
+        {
+            const std::lock_guard<std::mutex> lock (retireMutex);
+            reclaimable = scanLocked ();
+        }
+
+        for (auto& retired : reclaimable)
+            retired.deleter (retired.object);
+    }
+
+    size_t getNumPendingDeletions () const
+    {
+        const std::lock_guard<std::mutex> lock (retireMutex);
+        return retiredObjects.size ();
+    }
+
+private:
+    HazardPointers () = default;
+
+    struct RetiredObject
+    {
+        void* object;
+        void (*deleter) (void*);
+    };
+
+    Record* acquireGlobalRecord ()
+    {
+        for (auto* record = head.load (std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            auto expected = false;
+
+            if (! record->active.load (std::memory_order_relaxed)
+                 && record->active.compare_exchange_strong (expected, true, std::memory_order_acquire))
+                return record;
+        }
+
+        auto* record = new Record ();
+        record->active.store (true, std::memory_order_relaxed);
+        record->next = head.load (std::memory_order_relaxed);
+
+        while (! head.compare_exchange_weak (record->next, record, std::memory_order_release, std::memory_order_relaxed))
+        {}
+
+        numRecords.fetch_add (1, std::memory_order_relaxed);
+        return record;
+    }
+
+    static void releaseGlobalRecord (Record* record) noexcept
+    {
+        record->pointer.store (nullptr, std::memory_order_release);
+        record->active.store (false, std::memory_order_release);
+    }
+
+    /** A handful of hazard slots cached per thread, so pinning doesn't walk the global list. */
+    struct ThreadRecords
+    {
+        static constexpr int numCached = 4;
+
+        ~ThreadRecords ()
+        {
+            for (auto* record : records)
+                if (record != nullptr)
+                    releaseGlobalRecord (record);
+        }
+
+        Record* acquire ()
+        {
+            for (int i = 0; i < numCached; ++i)
+            {
+                if ((inUse & (1u << i)) == 0)
+                {
+                    if (records[i] == nullptr)
+                        records[i] = getInstance ().acquireGlobalRecord ();
+
+                    inUse |= (1u << i);
+                    return records[i];
+                }
+            }
+
+            // more nested pins than cached slots: fall back to the shared list
+            return getInstance ().acquireGlobalRecord ();
+        }
+
+        void release (Record* record) noexcept
+        {
+            for (int i = 0; i < numCached; ++i)
+            {
+                if (records[i] == record)
+                {
+                    record->pointer.store (nullptr, std::memory_order_release);
+                    inUse &= ~(1u << i);
+                    return;
+                }
+            }
+
+            releaseGlobalRecord (record);
+        }
+
+        Record* records[numCached] {};
+        uint32 inUse = 0;
+    };
+
+    static ThreadRecords& getThreadRecords ()
+    {
+        thread_local ThreadRecords threadRecords;
+        return threadRecords;
+    }
+
+    size_t scanThreshold () const noexcept
+    {
+        return 2 * (size_t) numRecords.load (std::memory_order_relaxed) + 16;
+    }
+
+    std::vector<RetiredObject> scanLocked ()
+    {
+        std::vector<const void*> hazards;
+
+        for (auto* record = head.load (std::memory_order_acquire); record != nullptr; record = record->next)
+            if (auto* pointer = record->pointer.load (std::memory_order_seq_cst))
+                hazards.push_back (pointer);
+
+        std::sort (hazards.begin (), hazards.end ());
+
+        std::vector<RetiredObject> reclaimable;
+
+        auto isPinned = [&hazards] (const RetiredObject& retired)
+        {
+            return std::binary_search (hazards.begin (), hazards.end (), (const void*) retired.object);
+        };
+
+        auto firstReclaimable = std::stable_partition (retiredObjects.begin (), retiredObjects.end (), isPinned);
+        reclaimable.assign (firstReclaimable, retiredObjects.end ());
+        retiredObjects.erase (firstReclaimable, retiredObjects.end ());
+
+        return reclaimable;
+    }
+
+    std::atomic<Record*> head { nullptr };
+    std::atomic<int> numRecords { 0 };
+
+    mutable std::mutex retireMutex;
+    std::vector<RetiredObject> retiredObjects;
+
+    JUCE_DECLARE_NON_COPYABLE (HazardPointers)
+};
+
+//==============================================================================
+template <class ObjectType>
+class ConcurrentWeakReference
+{
+public:
+    /** Shared between the object and all references to it. */
+    class SharedState : public ReferenceCountedObject
+    {
+    public:
+        explicit SharedState (ObjectType* o) : object (o) {}
+
+        std::atomic<ObjectType*> object;
+    };
+
+    using SharedStatePtr = ReferenceCountedObjectPtr<SharedState>;
+
+    /** Declared in the referenceable class by DECLARE_CONCURRENT_WEAK_REFERENCEABLE. */
+    class Master
+    {
+    public:
+        Master () = default;
+
+        ~Master ()
+        {
+            if (auto* state = sharedState.load (std::memory_order_acquire))
+            {
+                // objects that other threads may refer to must be deleted through retire ()
+                jassert (state->object.load () == nullptr);
+
+                state->object.store (nullptr);
+                state->decReferenceCount ();
+            }
+        }
+
+        SharedStatePtr getSharedState (ObjectType* object)
+        {
+            auto* state = sharedState.load (std::memory_order_acquire);
+
+            if (state == nullptr)
+            {
+                auto* newState = new SharedState (object);
+                newState->incReferenceCount ();
+
+                if (sharedState.compare_exchange_strong (state, newState, std::memory_order_acq_rel))
+                    state = newState;
+                else
+                    newState->decReferenceCount ();
+            }
+
+            return SharedStatePtr (state);
+        }
+
+        void clear () noexcept
+        {
+            if (auto* state = sharedState.load (std::memory_order_acquire))
+                state->object.store (nullptr, std::memory_order_seq_cst);
+        }
+
+    private:
+        std::atomic<SharedState*> sharedState { nullptr };
+
+        JUCE_DECLARE_NON_COPYABLE (Master)
+    };
+
+    /** Keeps the object alive while it exists. Don't hand it to other threads. */
+    class Pin
+    {
+    public:
+        Pin () = default;
+
+        Pin (Pin&& other) noexcept
+            : object (std::exchange (other.object, nullptr)),
+              record (std::exchange (other.record, nullptr)) {}
+
+        Pin& operator= (Pin&& other) noexcept
+        {
+            reset ();
+            object = std::exchange (other.object, nullptr);
+            record = std::exchange (other.record, nullptr);
+            return *this;
+        }
+
+        ~Pin () { reset (); }
+
+        void reset () noexcept
+        {
+            if (record != nullptr)
+                HazardPointers::getInstance ().release (record);
+
+            object = nullptr;
+            record = nullptr;
+        }
+
+        ObjectType* get () const noexcept               { return object; }
+        ObjectType* operator-> () const noexcept        { return object; }
+        ObjectType& operator* () const noexcept         { return *object; }
+        explicit operator bool () const noexcept        { return object != nullptr; }
+
+    private:
+        friend class ConcurrentWeakReference;
+
+        Pin (ObjectType* o, HazardPointers::Record* r) noexcept : object (o), record (r) {}
+
+        ObjectType* object = nullptr;
+        HazardPointers::Record* record = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (Pin)
+    };
+
+    //==============================================================================
+    ConcurrentWeakReference () = default;
+    ConcurrentWeakReference (ObjectType* object) : state (getStateFor (object)) {}
+
+    ConcurrentWeakReference& operator= (ObjectType* object) { state = getStateFor (object); return *this; }
+
+    /** Pins the object if it is still alive. Never blocks. */
+    Pin lock () const
+    {
+        if (state == nullptr)
+            return {};
+
+        auto& domain = HazardPointers::getInstance ();
+        auto* record = domain.acquire ();
+        auto* object = state->object.load (std::memory_order_acquire);
+
+        for (;;)
+        {
+            record->pointer.store (object, std::memory_order_seq_cst);
+            auto* confirmed = state->object.load (std::memory_order_seq_cst);
+
+            if (confirmed == object)
+                break;
+
+            object = confirmed;
+        }
+
+        if (object == nullptr)
+        {
+            domain.release (record);
+            return {};
+        }
+
+        return Pin (object, record);
+    }
+
+    /** A snapshot only: the object may die right after this returned true. Use lock () to access it. */
+    bool isAlive () const noexcept
+    {
+        return state != nullptr && state->object.load (std::memory_order_acquire) != nullptr;
+    }
+
+    /** Detaches the object from all references and deletes it once no thread has it pinned. */
+    static void retire (ObjectType* object)
+    {
+        if (object == nullptr)
+            return;
+
+        object->concurrentMasterReference.clear ();
+
+        HazardPointers::getInstance ().retire (object, [] (void* o) { delete static_cast<ObjectType*> (o); });
+    }
+
+private:
+    static SharedStatePtr getStateFor (ObjectType* object)
+    {
+        return object != nullptr ? object->concurrentMasterReference.getSharedState (object) : SharedStatePtr ();
+    }
+
+    SharedStatePtr state;
+};
+
+#define DECLARE_CONCURRENT_WEAK_REFERENCEABLE(Class) \
+    ConcurrentWeakReference<Class>::Master concurrentMasterReference; \
+    friend class ConcurrentWeakReference<Class>;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Trace.h"
+
+/**
+ * Deferred Deletion Queue
+ *
+ * When thousands of objects expire at the same moment, deleting them all in
+ * the callbacks that noticed the expiry blocks the message thread for that
+ * whole time and the UI hitches. Instead, expired objects are handed to this
+ * queue, which destroys them in batches: every tick only gets a small time
+ * budget (2 ms by default), and whatever doesn't fit is carried over to the
+ * next tick.
+ *
+ * DeferredDeletionQueue::deleteLater (expiredObject);
+ *
+ * Objects stay alive (and weak references to them stay valid) until the
+ * queue gets to them. Anything still queued at shutdown is deleted then.
+ */
+
+class DeferredDeletionQueue  : private Timer,
+                               private DeletedAtShutdown
+{
+public:
+    struct Statistics
+    {
+        size_t queueDepth = 0;
+        size_t peakQueueDepth = 0;
+        int64 totalDestroyed = 0;
+        int64 numTicks = 0;
+        int lastTickDestroyed = 0;
+        double lastTickMilliseconds = 0.0;
+        double maxTickMilliseconds = 0.0;
+    };
+
+    static DeferredDeletionQueue& getInstance ()
+    {
+        if (instance == nullptr)
+            instance = new DeferredDeletionQueue ();
+
+        return *instance;
+    }
+
+    ~DeferredDeletionQueue () override
+    {
+        stopTimer ();
+        flush ();
+        instance = nullptr;
+    }
+
+    template <class ObjectType>
+    static void deleteLater (ObjectType* object)
+    {
+        if (object != nullptr)
+            getInstance ().enqueue (object, [] (void* o) { delete static_cast<ObjectType*> (o); });
+    }
+
+    void enqueue (void* object, void (*deleter) (void*))
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        pending.push_back ({ object, deleter });
+        statistics.peakQueueDepth = jmax (statistics.peakQueueDepth, pending.size ());
+
+        if (! isTimerRunning ())
+            startTimerHz (ticksPerSecond);
+    }
+
+    /** How long a single tick may spend destroying objects. */
+    void setTimeBudget (double milliseconds) noexcept   { timeBudgetMilliseconds = milliseconds; }
+    double getTimeBudget () const noexcept              { return timeBudgetMilliseconds; }
+
+    Statistics getStatistics () const noexcept
+    {
+        auto result = statistics;
+        result.queueDepth = pending.size ();
+        return result;
+    }
+
+    /** Destroys everything that is queued right now, ignoring the budget. */
+    void flush ()
+    {
+        while (! pending.empty ())
+            destroyNext ();
+    }
+
+    static constexpr int ticksPerSecond = 60;
+
+private:
+    DeferredDeletionQueue () = default;
+
+    struct PendingDeletion
+    {
+        void* object;
+        void (*deleter) (void*);
+    };
+
+    void destroyNext ()
+    {
+        auto next = pending.front ();
+        pending.pop_front ();
+
+        // the destructor may queue further objects
+        next.deleter (next.object);
+        ++statistics.totalDestroyed;
+    }
+
+    void timerCallback () override
+    {
+        if (pending.empty ())
+        {
+            stopTimer ();
+            return;
+        }
+
+        TRACE_SCOPE ("DeferredDeletionQueue tick");
+        TRACE_COUNTER ("deletion queue depth", pending.size ());
+
+        auto start = Time::getHighResolutionTicks ();
+        auto budget = (int64) (timeBudgetMilliseconds * 0.001 * (double) Time::getHighResolutionTicksPerSecond ());
+        int destroyed = 0;
+
+        // always make some progress, even with a tiny budget
+        do
+        {
+            destroyNext ();
+            ++destroyed;
+        }
+        while (! pending.empty () && Time::getHighResolutionTicks () - start < budget);
+
+        auto milliseconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks () - start) * 1000.0;
+
+        ++statistics.numTicks;
+        statistics.lastTickDestroyed = destroyed;
+        statistics.lastTickMilliseconds = milliseconds;
+        statistics.maxTickMilliseconds = jmax (statistics.maxTickMilliseconds, milliseconds);
+
+        if (pending.empty ())
+            stopTimer ();
+    }
+
+    std::deque<PendingDeletion> pending;
+    double timeBudgetMilliseconds = 2.0;
+    Statistics statistics;
+
+    static inline DeferredDeletionQueue* instance = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (DeferredDeletionQueue)
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <string_view>
+
+/**
+ * Fixed Strings
+ *
+ * A juce::String at namespace scope, like
+ *
+ * const static inline String PluginName { "Extended Plugin" };
+ *
+ * is constructed at runtime during static initialisation, before main (): it
+ * allocates and copies the text, and every program that includes the header
+ * pays for it whether the string is used or not.
+ *
+ * A FixedString holds its characters inline and is built entirely at compile
+ * time, so a constexpr one is plain read-only data:
+ *
+ * constexpr FixedString PluginName { IF_EXTENDED ("Extended Plugin", "Normal Plugin") };
+ *
+ * The size is deduced from the literal. It converts to juce::StringRef
+ * without allocating, so it can be passed to anything that takes a
+ * StringRef, and toString () makes a juce::String where one is needed.
+ */
+
+template <size_t numChars>
+class FixedString
+{
+public:
+    /** From a string literal; numChars includes the terminating null. */
+    constexpr FixedString (const char (&text)[numChars]) noexcept
+    {
+        for (size_t i = 0; i < numChars; ++i)
+            chars[i] = text[i];
+    }
+
+    static constexpr size_t length () noexcept                  { return numChars - 1; }
+    static constexpr bool isEmpty () noexcept                   { return numChars <= 1; }
+
+    constexpr const char* data () const noexcept                { return chars; }
+    constexpr char operator[] (size_t index) const noexcept     { return chars[index]; }
+    constexpr std::string_view view () const noexcept           { return { chars, length () }; }
+
+    operator StringRef () const noexcept                        { return StringRef (chars); }
+
+    /** Allocates a juce::String with the same text. */
+    String toString () const                                    { return String::fromUTF8 (chars, (int) length ()); }
+
+    template <size_t otherNumChars>
+    constexpr bool operator== (const FixedString<otherNumChars>& other) const noexcept   { return view () == other.view (); }
+
+    template <size_t otherNumChars>
+    constexpr bool operator!= (const FixedString<otherNumChars>& other) const noexcept   { return view () != other.view (); }
+
+    // public so that a FixedString can be used as a template argument
+    char chars[numChars] = {};
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "LifetimeBenchmarks.h"
+#include "MicroBenchmark.h"
+#include "SelfDestructingObject.h"
+#include "ShardedLeakDetector.h"
+
+/**
+ * Headless Run
+ *
+ * Started with --headless, the application doesn't open a window. Instead it
+ * runs the pass/fail checks of the LifetimeBenchmarks and a stress test on
+ * the message loop, prints a summary and quits:
+ *
+ * Macros --headless --stress 10000 --duration 60 [--pooled] [--benchmarks | --no-benchmarks]
+ *
+ * The checks (the virtual lifetime replay and the concurrent weak reference
+ * stress test) run with small sizes, so they only take a moment. --benchmarks
+ * runs the whole benchmark suite at full size instead, which takes minutes;
+ * --no-benchmarks goes straight to the stress test.
+ *
+ * The stress test keeps --stress SelfDestructingObjects (default 1000) alive
+ * for --duration seconds (default 10): objects expire on their own, and the
+ * expired ones are replaced on every tick. Each object is followed with a
+ * weak reference, and every live object is touched on every tick, so an
+ * address sanitizer build catches an object that is used after it was freed.
+ * Once the duration is over no more objects are created, and the run ends
+ * when all of them are gone (or their lifetimes are long over).
+ *
+ * The run fails, and the application quits with exit code 1, if
+ *
+ * - a weak reference still points to an object after all lifetimes are over
+ *   (the object leaked, or was freed without clearing its references)
+ * - the leak detectors count objects that are still alive, or objects that
+ *   were deleted more than once (only with JUCE_CHECK_MEMORY_LEAKS)
+ * - the virtual lifetime replay doesn't destroy all of its objects
+ * - the concurrent weak reference stress test pins an object that was
+ *   already freed
+ */
+
+class HeadlessRun  : private Timer
+{
+public:
+    struct Options
+    {
+        int numObjects = 1000;
+        double durationSeconds = 10.0;
+        bool pooled = false;
+        bool runChecks = true;
+        bool runAllBenchmarks = false;
+    };
+
+    static bool isRequested (const String& commandLine)
+    {
+        return ArgumentList ({}, commandLine).containsOption ("--headless");
+    }
+
+    static Options parseOptions (const String& commandLine)
+    {
+        ArgumentList arguments ({}, commandLine);
+        Options options;
+
+        if (arguments.containsOption ("--stress"))
+            options.numObjects = jmax (0, MicroBenchmark::getOptionValue (arguments, "--stress").getIntValue ());
+
+        if (arguments.containsOption ("--duration"))
+            options.durationSeconds = jmax (0.0, MicroBenchmark::getOptionValue (arguments, "--duration").getDoubleValue ());
+
+        options.pooled = arguments.containsOption ("--pooled");
+        options.runChecks = ! arguments.containsOption ("--no-benchmarks");
+        options.runAllBenchmarks = options.runChecks && arguments.containsOption ("--benchmarks");
+        return options;
+    }
+
+    /** Starts the run on the message loop; onFinished is called with the exit code. */
+    HeadlessRun (Options runOptions, std::function<void (int)> onFinishedCallback)
+        : options (runOptions), onFinished (std::move (onFinishedCallback))
+    {
+        MessageManager::callAsync ([weak = WeakReference<HeadlessRun> (this)]
+        {
+            if (weak != nullptr)
+                weak->runBenchmarks ();
+        });
+    }
+
+    ~HeadlessRun () override
+    {
+        stopTimer ();
+    }
+
+private:
+    //==============================================================================
+    void runBenchmarks ()
+    {
+        if (options.runAllBenchmarks)
+            runAllBenchmarks ();
+        else if (options.runChecks)
+            runChecks (10000, 4, 256, 10);
+
+        startStress ();
+    }
+
+    /** The benchmarks that can fail; the sizes are those of the replay and the concurrent stress test. */
+    void runChecks (int numReplayObjects, int maxThreads, int numConcurrentObjects, int numConcurrentRounds)
+    {
+        print ("Running lifetime checks");
+
+        if (LifetimeBenchmarks::runVirtualLifetimeReplay (numReplayObjects) != numReplayObjects)
+            fail ("the virtual lifetime replay didn't destroy all of its objects");
+
+        auto numViolations = LifetimeBenchmarks::runConcurrentWeakReferenceBenchmarks (maxThreads, numConcurrentObjects, numConcurrentRounds);
+
+        if (numViolations > 0)
+            fail (String (numViolations) + " use-after-free(s) in the concurrent weak reference stress test");
+    }
+
+    void runAllBenchmarks ()
+    {
+        runChecks (100000, 16, 1024, 50);
+
+        print ("Running lifetime benchmarks");
+
+        LifetimeBenchmarks::runPoolChurnBenchmarks ();
+        LifetimeBenchmarks::runCallbackBenchmarks ();
+        LifetimeBenchmarks::runSchedulingBenchmarks ();
+
+        LifetimeBenchmarks::runWeakReferenceBenchmarks ();
+        LifetimeBenchmarks::runPooledWeakReferenceBenchmarks ();
+
+        LifetimeBenchmarks::runLeakDetectorContentionBenchmarks ();
+        LifetimeBenchmarks::runHeavyweightLeakDetectorBenchmarks ();
+        LifetimeBenchmarks::runLifetimeRandomBenchmarks ();
+        LifetimeBenchmarks::runNameBenchmarks ();
+        LifetimeBenchmarks::runMemoryFootprintReport ();
+    }
+
+    void startStress ()
+    {
+        print ("Stress test: " + String (options.numObjects) + " objects for " + String (options.durationSeconds, 1) + " s"
+               + (options.pooled ? ", pooled" : ""));
+
+        previousMode = SelfDestructingObject::getLifetimeMode ();
+        SelfDestructingObject::setLifetimeMode (options.pooled ? SelfDestructingObject::LifetimeMode::pooled
+                                                               : SelfDestructingObject::LifetimeMode::deleteOnExpiry);
+
+        auto now = Time::getMillisecondCounterHiRes ();
+        stressEndTime = now + options.durationSeconds * 1000.0;
+
+        // the longest lifetime, plus time for the deletion queue to catch up
+        finishDeadline = stressEndTime + LifetimeEnvironment::getLifetimeDistribution ().getMaxMilliseconds () + 2000.0;
+
+        startTimer (tickIntervalMs);
+    }
+
+    void timerCallback () override
+    {
+        auto now = Time::getMillisecondCounterHiRes ();
+
+        references.erase (std::remove_if (references.begin (), references.end (),
+                                          [] (const SelfDestructingObject::WeakRef& reference) { return reference == nullptr; }),
+                          references.end ());
+
+        for (auto& reference : references)
+            touchedNameHashes ^= (uint64) reference->getName ().hashCode64 ();
+
+        if (now < stressEndTime)
+        {
+            while ((int) references.size () < options.numObjects)
+            {
+                references.emplace_back (SelfDestructingObject::create ());
+                ++numCreated;
+            }
+
+            peakLive = jmax (peakLive, (int64) references.size ());
+            return;
+        }
+
+        if (references.empty () || now >= finishDeadline)
+            finish ();
+    }
+
+    void finish ()
+    {
+        stopTimer ();
+
+        DeferredDeletionQueue::getInstance ().flush ();
+        ObjectPool<SelfDestructingObject>::getInstance ().clear ();
+        SelfDestructingObject::setLifetimeMode (previousMode);
+
+        int64 numStale = 0;
+
+        for (auto& reference : references)
+            if (reference != nullptr)
+                ++numStale;
+
+        references.clear ();
+
+        print ("Created " + String (numCreated) + " objects, at most " + String (peakLive) + " alive at a time");
+
+        if (numStale > 0)
+            fail (String (numStale) + " object(s) still referenced after their lifetime");
+
+       #if JUCE_CHECK_MEMORY_LEAKS
+        for (auto& statistics : LeakDetectorRegistry::getInstance ().getStatistics ())
+        {
+            if (statistics.numLive > 0)
+                fail (String (statistics.numLive) + " leaked instance(s) of " + statistics.className);
+            else if (statistics.numLive < 0)
+                fail (String (-statistics.numLive) + " instance(s) of " + statistics.className + " deleted more than once");
+        }
+       #else
+        print ("Leak detectors are disabled in this build (JUCE_CHECK_MEMORY_LEAKS=0)");
+       #endif
+
+        print (numFailures == 0 ? "Headless run passed" : "Headless run FAILED");
+
+        if (onFinished != nullptr)
+            onFinished (numFailures == 0 ? 0 : 1);
+    }
+
+    //==============================================================================
+    static void print (const String& message)
+    {
+        std::cout << message << std::endl;
+    }
+
+    void fail (const String& reason)
+    {
+        ++numFailures;
+        std::cerr << "FAILED: " << reason << std::endl;
+    }
+
+    static constexpr int tickIntervalMs = 20;
+
+    Options options;
+    std::function<void (int)> onFinished;
+
+    std::vector<SelfDestructingObject::WeakRef> references;
+    SelfDestructingObject::LifetimeMode previousMode = SelfDestructingObject::LifetimeMode::deleteOnExpiry;
+    double stressEndTime = 0.0, finishDeadline = 0.0;
+    int64 numCreated = 0, peakLive = 0;
+    uint64 touchedNameHashes = 0;
+    int numFailures = 0;
+
+    // (no leak detector: the run is still alive when it checks the detectors)
+    JUCE_DECLARE_WEAK_REFERENCEABLE (HeadlessRun)
+    JUCE_DECLARE_NON_COPYABLE (HeadlessRun)
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Inplace Function
+ *
+ * std::function has to accept any callable, so anything bigger than its
+ * small internal buffer (which, in libstdc++, is also used only for trivially
+ * copyable callables) is copied to the heap. For callbacks that capture a
+ * weak reference and a pointer or two, that's an allocation per callback.
+ *
+ * InplaceFunction<void(), 32> stores the callable in a buffer of 32 bytes
+ * inside itself, always. A callable that doesn't fit is a compile error
+ * instead of a hidden allocation - raise the capacity, or capture less:
+ *
+ * InplaceFunction<void(), 32> callback = [weak = WeakReference<Thing> (thing)] { ... };
+ *
+ * It is move-only, so callables that can't be copied work too, and moving
+ * one is as cheap as moving the callable it holds. Calling an empty
+ * InplaceFunction is a bug (it asserts and does nothing).
+ */
+
+template <typename Signature, size_t capacity = 32>
+class InplaceFunction;
+
+template <typename Result, typename... Args, size_t capacity>
+class InplaceFunction<Result (Args...), capacity>
+{
+public:
+    InplaceFunction () noexcept = default;
+    InplaceFunction (std::nullptr_t) noexcept {}
+
+    template <typename Callable,
+              typename = std::enable_if_t<! std::is_same_v<std::decay_t<Callable>, InplaceFunction>>>
+    InplaceFunction (Callable&& callable)
+    {
+        using Stored = std::decay_t<Callable>;
+
+        static_assert (sizeof (Stored) <= capacity, "The callable doesn't fit into this InplaceFunction - increase its capacity");
+        static_assert (alignof (Stored) <= alignof (Storage), "The callable needs a stricter alignment than InplaceFunction provides");
+        static_assert (std::is_nothrow_move_constructible_v<Stored>, "The callable must be nothrow move constructible");
+        static_assert (std::is_invocable_r_v<Result, Stored&, Args...>, "The callable can't be called with this signature");
+
+        new (&storage) Stored (std::forward<Callable> (callable));
+        operations = &operationsFor<Stored>;
+    }
+
+    InplaceFunction (InplaceFunction&& other) noexcept
+    {
+        moveFrom (other);
+    }
+
+    InplaceFunction& operator= (InplaceFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset ();
+            moveFrom (other);
+        }
+
+        return *this;
+    }
+
+    InplaceFunction& operator= (std::nullptr_t) noexcept
+    {
+        reset ();
+        return *this;
+    }
+
+    ~InplaceFunction ()
+    {
+        reset ();
+    }
+
+    Result operator() (Args... args) const
+    {
+        jassert (operations != nullptr);
+
+        if (operations == nullptr)
+            return Result ();
+
+        return operations->invoke (const_cast<void*> (static_cast<const void*> (&storage)), std::forward<Args> (args)...);
+    }
+
+    explicit operator bool () const noexcept              { return operations != nullptr; }
+    bool operator== (std::nullptr_t) const noexcept       { return operations == nullptr; }
+    bool operator!= (std::nullptr_t) const noexcept       { return operations != nullptr; }
+
+    static constexpr size_t getCapacity () noexcept       { return capacity; }
+
+private:
+    using Storage = std::aligned_storage_t<capacity, alignof (std::max_align_t)>;
+
+    struct Operations
+    {
+        Result (*invoke) (void*, Args&&...);
+        void (*moveTo) (void* source, void* destination) noexcept;
+        void (*destroy) (void*) noexcept;
+    };
+
+    template <typename Stored>
+    static inline const Operations operationsFor
+    {
+        [] (void* callable, Args&&... args) -> Result
+        {
+            return (*static_cast<Stored*> (callable)) (std::forward<Args> (args)...);
+        },
+        [] (void* source, void* destination) noexcept
+        {
+            new (destination) Stored (std::move (*static_cast<Stored*> (source)));
+            static_cast<Stored*> (source)->~Stored ();
+        },
+        [] (void* callable) noexcept
+        {
+            static_cast<Stored*> (callable)->~Stored ();
+        }
+    };
+
+    void moveFrom (InplaceFunction& other) noexcept
+    {
+        if (other.operations != nullptr)
+        {
+            other.operations->moveTo (&other.storage, &storage);
+            operations = std::exchange (other.operations, nullptr);
+        }
+    }
+
+    void reset () noexcept
+    {
+        if (operations != nullptr)
+            std::exchange (operations, nullptr)->destroy (&storage);
+    }
+
+    Storage storage;
+    const Operations* operations = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (InplaceFunction)
+};
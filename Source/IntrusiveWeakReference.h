@@ -0,0 +1,210 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Intrusive Weak References
+ *
+ * The Master that JUCE_DECLARE_WEAK_REFERENCEABLE adds to a class allocates
+ * its SharedPointer with new the first time a WeakReference is taken, so the
+ * control blocks end up scattered all over the heap and every check is a
+ * likely cache miss.
+ *
+ * DECLARE_INTRUSIVE_WEAK_REFERENCEABLE works the same way, but takes the
+ * control blocks from a per-class pool: they are allocated in chunks, reused
+ * through a free list and never move, so taking the first reference doesn't
+ * call the general-purpose allocator, and checks touch a few contiguous
+ * blocks of memory. Like a SharedPointer, a block lives as long as its object
+ * or any reference to it - whichever is longer - and then goes back to the
+ * pool.
+ *
+ * class MyObject
+ * {
+ *     DECLARE_INTRUSIVE_WEAK_REFERENCEABLE (MyObject)
+ * };
+ *
+ * IntrusiveWeakReference<MyObject> weak (obj);
+ * if (weak)
+ *     weak->doSomething ();
+ *
+ * Just like WeakReference, this is not thread safe: create, check and delete
+ * the objects and their references on the same thread (usually the message
+ * thread).
+ */
+
+template <class ObjectType>
+class WeakControlBlockPool
+{
+public:
+    struct Block
+    {
+        ObjectType* object;
+        uint32 refCount;
+        Block* nextFree;
+    };
+
+    static WeakControlBlockPool& getInstance ()
+    {
+        static WeakControlBlockPool pool;
+        return pool;
+    }
+
+    /** Returns a block referring to the object, with a count of one. */
+    Block* acquire (ObjectType* object)
+    {
+        if (firstFree == nullptr)
+            addChunk ();
+
+        auto* block = firstFree;
+        firstFree = block->nextFree;
+
+        block->object = object;
+        block->refCount = 1;
+        block->nextFree = nullptr;
+        ++numInUse;
+
+        return block;
+    }
+
+    static void addReference (Block* block) noexcept
+    {
+        if (block != nullptr)
+            ++block->refCount;
+    }
+
+    void releaseReference (Block* block) noexcept
+    {
+        if (block == nullptr || --block->refCount > 0)
+            return;
+
+        block->object = nullptr;
+        block->nextFree = firstFree;
+        firstFree = block;
+        --numInUse;
+    }
+
+    size_t getNumBlocksInUse () const noexcept   { return numInUse; }
+    size_t getNumBlocks () const noexcept        { return chunks.size () * blocksPerChunk; }
+
+    static constexpr size_t blocksPerChunk = 1024;
+
+private:
+    WeakControlBlockPool () = default;
+
+    void addChunk ()
+    {
+        chunks.emplace_back (new Block[blocksPerChunk]);
+        auto* chunk = chunks.back ().get ();
+
+        for (size_t i = blocksPerChunk; i-- > 0;)
+        {
+            chunk[i] = { nullptr, 0, firstFree };
+            firstFree = chunk + i;
+        }
+    }
+
+    std::vector<std::unique_ptr<Block[]>> chunks;
+    Block* firstFree = nullptr;
+    size_t numInUse = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (WeakControlBlockPool)
+};
+
+//==============================================================================
+/** The member that DECLARE_INTRUSIVE_WEAK_REFERENCEABLE adds; clears all references when destroyed. */
+template <class ObjectType>
+class IntrusiveWeakMaster
+{
+public:
+    using Pool = WeakControlBlockPool<ObjectType>;
+
+    IntrusiveWeakMaster () = default;
+    ~IntrusiveWeakMaster ()  { clear (); }
+
+    /** Returns the object's block, taking it from the pool on first use. */
+    typename Pool::Block* getBlock (ObjectType* object)
+    {
+        if (block == nullptr)
+            block = Pool::getInstance ().acquire (object);
+
+        return block;
+    }
+
+    /** Nulls all references to the object. New references can be made afterwards. */
+    void clear () noexcept
+    {
+        if (block != nullptr)
+        {
+            block->object = nullptr;
+            Pool::getInstance ().releaseReference (std::exchange (block, nullptr));
+        }
+    }
+
+    int getNumActiveWeakReferences () const noexcept
+    {
+        return block == nullptr ? 0 : (int) block->refCount - 1;
+    }
+
+private:
+    typename Pool::Block* block = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (IntrusiveWeakMaster)
+};
+
+/** A drop-in alternative to WeakReference for classes declared with DECLARE_INTRUSIVE_WEAK_REFERENCEABLE. */
+template <class ObjectType>
+class IntrusiveWeakReference
+{
+public:
+    using Pool = WeakControlBlockPool<ObjectType>;
+
+    IntrusiveWeakReference () = default;
+    IntrusiveWeakReference (ObjectType* object) : block (getBlockFor (object)) { Pool::addReference (block); }
+
+    IntrusiveWeakReference (const IntrusiveWeakReference& other) noexcept : block (other.block)   { Pool::addReference (block); }
+    IntrusiveWeakReference (IntrusiveWeakReference&& other) noexcept : block (std::exchange (other.block, nullptr)) {}
+
+    ~IntrusiveWeakReference ()  { Pool::getInstance ().releaseReference (block); }
+
+    IntrusiveWeakReference& operator= (const IntrusiveWeakReference& other) noexcept
+    {
+        Pool::addReference (other.block);
+        Pool::getInstance ().releaseReference (std::exchange (block, other.block));
+        return *this;
+    }
+
+    IntrusiveWeakReference& operator= (IntrusiveWeakReference&& other) noexcept
+    {
+        if (this != &other)
+            Pool::getInstance ().releaseReference (std::exchange (block, std::exchange (other.block, nullptr)));
+
+        return *this;
+    }
+
+    IntrusiveWeakReference& operator= (ObjectType* object)
+    {
+        return *this = IntrusiveWeakReference (object);
+    }
+
+    ObjectType* get () const noexcept               { return block != nullptr ? block->object : nullptr; }
+    operator ObjectType* () const noexcept          { return get (); }
+    ObjectType* operator-> () const noexcept        { return get (); }
+
+    bool operator== (ObjectType* object) const noexcept { return get () == object; }
+    bool operator!= (ObjectType* object) const noexcept { return get () != object; }
+
+    /** True if this referred to an object that has since been deleted. */
+    bool wasObjectDeleted () const noexcept         { return block != nullptr && block->object == nullptr; }
+
+private:
+    static typename Pool::Block* getBlockFor (ObjectType* object)
+    {
+        return object != nullptr ? object->intrusiveWeakMaster.getBlock (object) : nullptr;
+    }
+
+    typename Pool::Block* block = nullptr;
+};
+
+#define DECLARE_INTRUSIVE_WEAK_REFERENCEABLE(Class) \
+    IntrusiveWeakMaster<Class> intrusiveWeakMaster; \
+    friend class IntrusiveWeakReference<Class>;
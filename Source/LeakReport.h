@@ -0,0 +1,91 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ShardedLeakDetector.h"
+
+/**
+ * Leak Report
+ *
+ * The leak detectors only assert and print to the debugger, which is fine
+ * while debugging but useless for a soak test that runs unattended. At
+ * shutdown the application writes what the sharded leak detectors know to a
+ * file, one entry per class:
+ *
+ * - the number of constructions and the sampled peak number of live objects
+ * - the number of objects still alive, i.e. leaked
+ * - sizeof the class, and the bytes estimated from it for the peak and the leaks
+ *
+ * The estimate only counts the object itself, not what it allocates. Keeping
+ * an exact peak would need one shared counter again, so the live objects are
+ * only added up at each thread's first 64 constructions of a class and then
+ * at every 64th, so sampledPeakLive can miss short spikes. Classes without
+ * any constructions are listed with zeros.
+ *
+ * The file is JSON, or CSV if its name ends in .csv. Its location comes from
+ * the LEAK_REPORT_PATH environment variable, and defaults to
+ * "<projectName>-leaks.json" in the temp directory. Entries are sorted by
+ * class name, so that two reports can be diffed directly.
+ *
+ * Only classes that use DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR are
+ * listed, and only when JUCE_CHECK_MEMORY_LEAKS is enabled. Soak-test release
+ * builds need JUCE_CHECK_MEMORY_LEAKS=1 in their preprocessor definitions.
+ */
+
+namespace LeakReport
+{
+    static inline File getDefaultOutputFile ()
+    {
+        auto path = SystemStats::getEnvironmentVariable ("LEAK_REPORT_PATH", {});
+
+        if (path.isNotEmpty ())
+            return File::getCurrentWorkingDirectory ().getChildFile (path);
+
+        return File::getSpecialLocation (File::tempDirectory).getChildFile (String (ProjectInfo::projectName) + "-leaks.json");
+    }
+
+    static inline String toJson (const std::vector<LeakDetectorStatistics>& classes)
+    {
+        String json;
+        json << "{\"project\":\"" << ProjectInfo::projectName << "\",\"version\":\"" << ProjectInfo::versionString
+             << "\",\"classes\":[";
+
+        for (size_t i = 0; i < classes.size (); ++i)
+        {
+            auto& c = classes[i];
+
+            json << (i == 0 ? "\n" : ",\n")
+                 << "{\"name\":\"" << c.className << "\""
+                 << ",\"sizeof\":" << (int64) c.objectSize
+                 << ",\"constructed\":" << c.numConstructed
+                 << ",\"sampledPeakLive\":" << c.sampledPeakLive
+                 << ",\"leaked\":" << c.numLive
+                 << ",\"estimatedPeakBytes\":" << c.sampledPeakLive * (int64) c.objectSize
+                 << ",\"estimatedLeakedBytes\":" << c.numLive * (int64) c.objectSize
+                 << "}";
+        }
+
+        json << "\n]}\n";
+        return json;
+    }
+
+    static inline String toCsv (const std::vector<LeakDetectorStatistics>& classes)
+    {
+        String csv;
+        csv << "class,sizeof,constructed,sampledPeakLive,leaked,estimatedPeakBytes,estimatedLeakedBytes\n";
+
+        for (auto& c : classes)
+            csv << c.className << "," << (int64) c.objectSize << "," << c.numConstructed << ","
+                << c.sampledPeakLive << "," << c.numLive << ","
+                << c.sampledPeakLive * (int64) c.objectSize << "," << c.numLive * (int64) c.objectSize << "\n";
+
+        return csv;
+    }
+
+    /** Writes the report for all registered classes; call it once the objects that should be gone are gone. */
+    static inline bool write (const File& file)
+    {
+        auto classes = LeakDetectorRegistry::getInstance ().getStatistics ();
+
+        return file.replaceWithText (file.hasFileExtension (".csv") ? toCsv (classes) : toJson (classes));
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LifetimeRandom.h"
+
+/**
+ * Lifetime Clock
+ *
+ * Object lifetimes are measured against a LifetimeClock instead of reading
+ * the system time directly. The application runs on the SystemLifetimeClock;
+ * a test or benchmark can install a VirtualLifetimeClock and move time
+ * forward instantly instead of waiting for it.
+ *
+ * Together with a fixed random seed this makes lifetime runs reproducible:
+ *
+ * VirtualLifetimeClock clock;
+ * LifetimeEnvironment::setClock (&clock);
+ * LifetimeEnvironment::setSeed (1234);
+ * LifetimeEnvironment::setLifetimeDistribution (LifetimeDistribution::exponential (1000.0));
+ *
+ * ... create objects ...
+ *
+ * clock.advance (3000);
+ * LifetimeScheduler::getInstance ().update ();
+ *
+ * LifetimeEnvironment::setClock (nullptr); // back to the system clock
+ *
+ * Every thread draws from a LifetimeRandom of its own, so threads never wait
+ * for each other. setSeed () reseeds them all: the calling thread gets stream
+ * 0 of the seed, and each other thread its own stream the next time it draws.
+ */
+
+class LifetimeClock
+{
+public:
+    virtual ~LifetimeClock () = default;
+
+    virtual int64 getMilliseconds () const = 0;
+};
+
+class SystemLifetimeClock  : public LifetimeClock
+{
+public:
+    int64 getMilliseconds () const override { return (int64) Time::getMillisecondCounterHiRes (); }
+};
+
+class VirtualLifetimeClock  : public LifetimeClock
+{
+public:
+    explicit VirtualLifetimeClock (int64 startTime = 0) : now (startTime) {}
+
+    int64 getMilliseconds () const override    { return now; }
+
+    void advance (int64 milliseconds) noexcept  { jassert (milliseconds >= 0); now += milliseconds; }
+    void setTime (int64 time) noexcept          { jassert (time >= now); now = time; }
+
+private:
+    int64 now;
+};
+
+//==============================================================================
+/** The clock, random source and lifetime distribution used for object lifetimes. */
+class LifetimeEnvironment
+{
+public:
+    /** Use the clock from the message thread. */
+    static const LifetimeClock& getClock () noexcept
+    {
+        return clock != nullptr ? *clock : systemClock;
+    }
+
+    /**
+     * Installs a clock (owned by the caller), or the system clock again if
+     * nullptr. Callbacks already in the LifetimeScheduler keep their
+     * remaining delays, measured on the new clock.
+     */
+    static void setClock (const LifetimeClock* newClock) noexcept
+    {
+        clock = newClock;
+    }
+
+    /** The calling thread's generator. */
+    static LifetimeRandom& getRandom () noexcept
+    {
+        auto& generator = getThreadGenerator ();
+        auto currentEpoch = seedEpoch.load (std::memory_order_acquire);
+
+        if (generator.epoch != currentEpoch)
+        {
+            generator.random.setSeed (baseSeed.load (std::memory_order_relaxed), generator.streamIndex);
+            generator.epoch = currentEpoch;
+        }
+
+        return generator.random;
+    }
+
+    static void setSeed (int64 seed) noexcept
+    {
+        baseSeed.store (seed, std::memory_order_relaxed);
+        auto newEpoch = seedEpoch.fetch_add (1, std::memory_order_release) + 1;
+
+        auto& generator = getThreadGenerator ();
+        generator.random.setSeed (seed, 0);
+        generator.epoch = newEpoch;
+    }
+
+    /** Set the distribution from the message thread, before objects that use it are created. */
+    static void setLifetimeDistribution (LifetimeDistribution newDistribution) noexcept
+    {
+        distribution = newDistribution;
+    }
+
+    static const LifetimeDistribution& getLifetimeDistribution () noexcept
+    {
+        return distribution;
+    }
+
+    /** Draws a lifetime in milliseconds from the lifetime distribution. */
+    static int nextLifetime () noexcept
+    {
+        return distribution.sample (getRandom ());
+    }
+
+    /** Draws numLifetimes lifetimes at once. */
+    static void fillLifetimes (int* destination, int numLifetimes) noexcept
+    {
+        distribution.fill (getRandom (), destination, numLifetimes);
+    }
+
+private:
+    struct ThreadGenerator
+    {
+        LifetimeRandom random;
+        uint64 epoch = 0;
+        uint64 streamIndex = nextStreamIndex.fetch_add (1, std::memory_order_relaxed);
+    };
+
+    static ThreadGenerator& getThreadGenerator () noexcept
+    {
+        thread_local ThreadGenerator generator;
+        return generator;
+    }
+
+    static inline SystemLifetimeClock systemClock;
+    static inline const LifetimeClock* clock = nullptr;
+    static inline LifetimeDistribution distribution = LifetimeDistribution::uniform (0, 3000);
+
+    // unseeded runs start from the time; setSeed () makes them reproducible
+    static inline std::atomic<int64> baseSeed { Time::currentTimeMillis () ^ Time::getHighResolutionTicks () };
+    static inline std::atomic<uint64> seedEpoch { 1 };
+    static inline std::atomic<uint64> nextStreamIndex { 1 };
+};
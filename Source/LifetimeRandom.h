@@ -0,0 +1,196 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Lifetime Random
+ *
+ * juce::Random is a simple linear congruential generator, and the one shared
+ * by the whole process (Random::getSystemRandom ()) isn't meant to be used
+ * from several threads at once. Lifetimes are drawn for every object that is
+ * created, so they get a generator of their own: LifetimeRandom is
+ * xoshiro256** (Blackman and Vigna), which is fast, has a 256 bit state and
+ * passes the usual statistical test suites.
+ *
+ * LifetimeRandom random (1234);
+ * auto milliseconds = random.nextInt (3000);
+ *
+ * Generators for several threads should not share a seed; give each one a
+ * different stream instead, LifetimeRandom (seed, streamIndex). The streams
+ * are seeded through SplitMix64, so neighbouring seeds and streams give
+ * unrelated sequences.
+ *
+ * LifetimeDistribution turns random numbers into lifetimes in milliseconds:
+ * uniform (what the project has always used), exponential (most objects die
+ * young, a few live long) or Pareto (heavy tailed: a handful of objects
+ * outlive all others by far). Exponential and Pareto lifetimes are cut off at
+ * a maximum. fill () draws a whole array of lifetimes in one call, which
+ * keeps the generator state in registers and chooses the shape once per
+ * batch instead of once per value.
+ */
+
+class LifetimeRandom
+{
+public:
+    explicit LifetimeRandom (int64 seed = 0) noexcept                  { setSeed (seed); }
+    LifetimeRandom (int64 seed, uint64 streamIndex) noexcept          { setSeed (seed, streamIndex); }
+
+    void setSeed (int64 seed, uint64 streamIndex = 0) noexcept
+    {
+        auto x = (uint64) seed ^ (streamIndex * 0xd1342543de82ef95ull);
+
+        for (auto& word : state)
+            word = splitMix64 (x);
+    }
+
+    uint64 nextUint64 () noexcept
+    {
+        auto result = rotateLeft (state[1] * 5, 7) * 9;
+        auto t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft (state[3], 45);
+
+        return result;
+    }
+
+    /** Returns a number from 0 up to (but not including) maxValue. */
+    int nextInt (int maxValue) noexcept
+    {
+        jassert (maxValue > 0);
+
+        // multiply-shift instead of a modulo (Lemire); the bias is far below anything measurable here
+        return (int) (((nextUint64 () >> 32) * (uint64) maxValue) >> 32);
+    }
+
+    /** Returns a number from 0.0 up to (but not including) 1.0. */
+    double nextDouble () noexcept
+    {
+        return (double) (nextUint64 () >> 11) * 0x1.0p-53;
+    }
+
+    /** Fills destination with numbers from 0 up to (but not including) maxValue. */
+    void fillInts (int* destination, int numValues, int maxValue) noexcept
+    {
+        jassert (maxValue > 0);
+        auto generator = *this;
+
+        for (int i = 0; i < numValues; ++i)
+            destination[i] = (int) (((generator.nextUint64 () >> 32) * (uint64) maxValue) >> 32);
+
+        *this = generator;
+    }
+
+private:
+    static constexpr uint64 rotateLeft (uint64 x, int bits) noexcept   { return (x << bits) | (x >> (64 - bits)); }
+
+    static uint64 splitMix64 (uint64& x) noexcept
+    {
+        auto z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    uint64 state[4];
+};
+
+//==============================================================================
+/** A distribution of object lifetimes, in milliseconds. */
+class LifetimeDistribution
+{
+public:
+    enum class Shape
+    {
+        uniform,
+        exponential,
+        pareto
+    };
+
+    /** Lifetimes from minMilliseconds up to (but not including) maxMilliseconds, all equally likely. */
+    static LifetimeDistribution uniform (int minMilliseconds, int maxMilliseconds) noexcept
+    {
+        jassert (maxMilliseconds > minMilliseconds);
+        return { Shape::uniform, (double) minMilliseconds, 0.0, minMilliseconds, maxMilliseconds };
+    }
+
+    /** Lifetimes with the given mean, where each object is as likely to expire in the next millisecond as any other. */
+    static LifetimeDistribution exponential (double meanMilliseconds, int maxMilliseconds = 60000) noexcept
+    {
+        jassert (meanMilliseconds > 0.0);
+        return { Shape::exponential, meanMilliseconds, 0.0, 0, maxMilliseconds };
+    }
+
+    /**
+     * Lifetimes of at least minMilliseconds with a Pareto tail: the smaller
+     * the shape (1.0 to 3.0 is typical), the more very long lived objects.
+     */
+    static LifetimeDistribution pareto (double minMilliseconds, double shape, int maxMilliseconds = 60000) noexcept
+    {
+        jassert (minMilliseconds > 0.0 && shape > 0.0);
+        return { Shape::pareto, minMilliseconds, 1.0 / shape, 0, maxMilliseconds };
+    }
+
+    Shape getShape () const noexcept        { return shape; }
+    int getMaxMilliseconds () const noexcept { return maxMilliseconds; }
+
+    int sample (LifetimeRandom& random) const noexcept
+    {
+        switch (shape)
+        {
+            case Shape::uniform:        return minMilliseconds + random.nextInt (maxMilliseconds - minMilliseconds);
+            case Shape::exponential:    return toMilliseconds (drawExponential (random.nextDouble ()));
+            case Shape::pareto:         return toMilliseconds (drawPareto (random.nextDouble ()));
+        }
+
+        return minMilliseconds;
+    }
+
+    /** Draws numValues lifetimes into destination. */
+    void fill (LifetimeRandom& random, int* destination, int numValues) const noexcept
+    {
+        switch (shape)
+        {
+            case Shape::uniform:
+                random.fillInts (destination, numValues, maxMilliseconds - minMilliseconds);
+
+                for (int i = 0; i < numValues; ++i)
+                    destination[i] += minMilliseconds;
+
+                break;
+
+            case Shape::exponential:
+                for (int i = 0; i < numValues; ++i)
+                    destination[i] = toMilliseconds (drawExponential (random.nextDouble ()));
+
+                break;
+
+            case Shape::pareto:
+                for (int i = 0; i < numValues; ++i)
+                    destination[i] = toMilliseconds (drawPareto (random.nextDouble ()));
+
+                break;
+        }
+    }
+
+private:
+    LifetimeDistribution (Shape s, double p1, double p2, int minimum, int maximum) noexcept
+        : shape (s), parameter1 (p1), parameter2 (p2), minMilliseconds (minimum), maxMilliseconds (maximum) {}
+
+    // u is in [0, 1), so 1 - u is never 0
+    double drawExponential (double u) const noexcept   { return -parameter1 * std::log (1.0 - u); }
+    double drawPareto (double u) const noexcept        { return parameter1 * std::pow (1.0 - u, -parameter2); }
+
+    int toMilliseconds (double value) const noexcept
+    {
+        return value < (double) maxMilliseconds ? (int) value : maxMilliseconds;
+    }
+
+    Shape shape;
+    double parameter1, parameter2;   // mean for exponential; minimum and 1 / shape for Pareto
+    int minMilliseconds, maxMilliseconds;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TimingWheel.h"
+#include "LifetimeClock.h"
+
+/**
+ * Lifetime Scheduler
+ *
+ * Timer::callAfterDelay allocates a Timer per call and inserts it into the
+ * shared, sorted timer list, so the cost grows with the number of pending
+ * callbacks. The LifetimeScheduler keeps all delayed callbacks in one
+ * TimingWheel that is driven by a single juce::Timer, which only runs while
+ * something is pending.
+ *
+ * LifetimeScheduler::callAfterDelay (500, [] { DBG ("later"); });
+ *
+ * Time is taken from the LifetimeEnvironment clock, so with a
+ * VirtualLifetimeClock installed nothing fires until update () is called.
+ * When a different clock is installed, the wheel carries on from its own
+ * time: callbacks that are still pending keep their remaining delays,
+ * measured on the new clock.
+ *
+ * callAfterDelay returns a handle, and cancel () removes the callback in
+ * O(1). An object that schedules callbacks for itself can keep the handle in
+ * a ScopedDelayedCallback, which cancels when the object is deleted, so the
+ * callbacks of dead objects don't stay in the wheel until they are due:
+ *
+ * expiry = LifetimeScheduler::callAfterDelay (1000, [this] { expire (); });
+ *
+ * Callbacks are invoked on the message thread, like Timer::callAfterDelay.
+ * The instance is deleted at shutdown together with the other
+ * DeletedAtShutdown objects; pending callbacks are dropped then.
+ */
+
+class LifetimeScheduler  : private Timer,
+                           private DeletedAtShutdown
+{
+public:
+    using Handle = TimingWheel::Handle;
+
+    static LifetimeScheduler& getInstance ()
+    {
+        if (instance == nullptr)
+            instance = new LifetimeScheduler ();
+
+        return *instance;
+    }
+
+    ~LifetimeScheduler () override
+    {
+        stopTimer ();
+        instance = nullptr;
+    }
+
+    /** Same contract as Timer::callAfterDelay, but returns a handle that can be cancelled. */
+    static Handle callAfterDelay (int milliseconds, TimingWheel::Callback callback)
+    {
+        return getInstance ().schedule (milliseconds, std::move (callback));
+    }
+
+    static bool cancel (Handle handle)
+    {
+        return instance != nullptr && instance->wheel.cancel (handle);
+    }
+
+    static bool isPending (Handle handle)
+    {
+        return instance != nullptr && instance->wheel.isPending (handle);
+    }
+
+    Handle schedule (int milliseconds, TimingWheel::Callback callback)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        // the wheel may be behind (it doesn't tick while idle) or on another clock's time base
+        if (wheel.isEmpty ())
+            wheel.reset (getTime ());
+
+        auto handle = wheel.schedule (getTime () + jmax (0, milliseconds), std::move (callback));
+
+        if (! isTimerRunning ())
+            startTimer (tickIntervalMs);
+
+        return handle;
+    }
+
+    /**
+     * Fires everything that is due according to the LifetimeEnvironment clock.
+     * The timer calls this; call it directly after advancing a VirtualLifetimeClock.
+     */
+    void update ()
+    {
+        wheel.advanceTo (getTime ());
+
+        if (wheel.isEmpty ())
+            stopTimer ();
+    }
+
+    size_t getNumPending () const noexcept { return wheel.getNumPending (); }
+
+    static constexpr int tickIntervalMs = 5;
+
+private:
+    LifetimeScheduler ()
+    {
+        wheel.reset (getTime ());
+    }
+
+    /** The LifetimeEnvironment clock, shifted onto the wheel's time base (the clocks don't share one). */
+    int64 getTime ()
+    {
+        auto& clock = LifetimeEnvironment::getClock ();
+
+        if (&clock != currentClock)
+        {
+            timeOffset = wheel.getCurrentTime () - clock.getMilliseconds ();
+            currentClock = &clock;
+        }
+
+        return clock.getMilliseconds () + timeOffset;
+    }
+
+    void timerCallback () override
+    {
+        update ();
+    }
+
+    TimingWheel wheel;
+    const LifetimeClock* currentClock = nullptr;
+    int64 timeOffset = 0;
+
+    static inline LifetimeScheduler* instance = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (LifetimeScheduler)
+};
+
+//==============================================================================
+/** Owns a scheduled callback and cancels it when destroyed or reassigned. */
+class ScopedDelayedCallback
+{
+public:
+    ScopedDelayedCallback () = default;
+    ScopedDelayedCallback (LifetimeScheduler::Handle handleToOwn) noexcept : handle (handleToOwn) {}
+
+    ScopedDelayedCallback (ScopedDelayedCallback&& other) noexcept
+        : handle (std::exchange (other.handle, {})) {}
+
+    ScopedDelayedCallback& operator= (ScopedDelayedCallback&& other) noexcept
+    {
+        if (this != &other)
+        {
+            cancel ();
+            handle = std::exchange (other.handle, {});
+        }
+
+        return *this;
+    }
+
+    ~ScopedDelayedCallback ()
+    {
+        cancel ();
+    }
+
+    /** Removes the callback if it hasn't fired yet. */
+    void cancel ()
+    {
+        LifetimeScheduler::cancel (std::exchange (handle, {}));
+    }
+
+    /** Gives up ownership: the callback stays scheduled. */
+    LifetimeScheduler::Handle release () noexcept   { return std::exchange (handle, {}); }
+
+    bool isPending () const                         { return LifetimeScheduler::isPending (handle); }
+
+private:
+    LifetimeScheduler::Handle handle;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedDelayedCallback)
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <coroutine>
+#include <exception>
+#include "LifetimeScheduler.h"
+#include "InplaceFunction.h"
+
+/**
+ * Lifetime Tasks
+ *
+ * A sequence like "wait, check, act, wait again" written with callbacks is a
+ * chain of nested lambdas, each with its own weak reference check. With C++20
+ * coroutines it reads from top to bottom:
+ *
+ * LifetimeTask Thing::run ()
+ * {
+ *     co_await delayFor (500);
+ *     blink ();
+ *     co_await delayFor (1000);
+ *     disappear ();
+ * }
+ *
+ * delayFor () suspends the coroutine and resumes it from the LifetimeScheduler
+ * on the message thread. When a LifetimeTask is a member function of a class
+ * that declares a WeakRef (like NamedLifetimeObject), its frame holds a weak
+ * reference to the object: if the object is gone by the time a delay is over,
+ * the coroutine is destroyed instead of resumed, so the code after a co_await
+ * can always use the object. Passing a ScopedDelayedCallback as well,
+ * co_await delayFor (500, pendingDelay), also cancels the delay - and destroys
+ * the frame - as soon as the object that owns pendingDelay is deleted.
+ *
+ * A LifetimeTask starts running when it is called and can't be awaited
+ * itself: nobody owns it, its frame is freed when it finishes or is dropped.
+ * Frames come from a CoroutineFrameAllocator that keeps freed frames for
+ * reuse, so after warming up, starting a task doesn't allocate. Like the
+ * scheduler, tasks are for the message thread only.
+ */
+
+class CoroutineFrameAllocator
+{
+public:
+    struct Statistics
+    {
+        int64 numAllocations = 0;
+        int64 numReused = 0;
+        int64 numOversized = 0;
+    };
+
+    static void* allocate (size_t size)
+    {
+        auto& allocator = getInstance ();
+        ++allocator.statistics.numAllocations;
+
+        auto sizeClass = getSizeClass (size);
+
+        if (sizeClass >= numSizeClasses)
+        {
+            ++allocator.statistics.numOversized;
+            return ::operator new (size);
+        }
+
+        if (auto* frame = allocator.freeLists[sizeClass])
+        {
+            allocator.freeLists[sizeClass] = frame->next;
+            ++allocator.statistics.numReused;
+            return frame;
+        }
+
+        return ::operator new ((size_t) (sizeClass + 1) * granularity);
+    }
+
+    static void deallocate (void* pointer, size_t size) noexcept
+    {
+        auto sizeClass = getSizeClass (size);
+
+        if (sizeClass >= numSizeClasses)
+        {
+            ::operator delete (pointer);
+            return;
+        }
+
+        auto& allocator = getInstance ();
+        auto* frame = static_cast<FreeFrame*> (pointer);
+        frame->next = allocator.freeLists[sizeClass];
+        allocator.freeLists[sizeClass] = frame;
+    }
+
+    static Statistics getStatistics () noexcept   { return getInstance ().statistics; }
+
+    static constexpr size_t granularity = 64;
+    static constexpr size_t numSizeClasses = 32;   // frames up to 2 KB are recycled
+
+private:
+    CoroutineFrameAllocator () = default;
+
+    ~CoroutineFrameAllocator ()
+    {
+        for (auto* frame : freeLists)
+            while (frame != nullptr)
+                ::operator delete (std::exchange (frame, frame->next));
+    }
+
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    static size_t getSizeClass (size_t size) noexcept   { return (jmax ((size_t) 1, size) - 1) / granularity; }
+
+    static CoroutineFrameAllocator& getInstance ()
+    {
+        static CoroutineFrameAllocator allocator;
+        return allocator;
+    }
+
+    FreeFrame* freeLists[numSizeClasses] = {};
+    Statistics statistics;
+
+    JUCE_DECLARE_NON_COPYABLE (CoroutineFrameAllocator)
+};
+
+//==============================================================================
+template <class Owner, class = void>
+struct DeclaresWeakRef  : std::false_type {};
+
+template <class Owner>
+struct DeclaresWeakRef<Owner, std::void_t<typename Owner::WeakRef>>  : std::true_type {};
+
+class LifetimeTask
+{
+public:
+    struct promise_type
+    {
+        promise_type () = default;
+
+        /** For member coroutines the object comes first; keep a weak reference to it if it has a WeakRef. */
+        template <class Owner, typename... Args>
+        promise_type (Owner& owner, Args&...)  : guard (makeGuard (owner)) {}
+
+        LifetimeTask get_return_object () noexcept    { return {}; }
+        std::suspend_never initial_suspend () noexcept  { return {}; }
+        std::suspend_never final_suspend () noexcept    { return {}; }
+        void return_void () noexcept {}
+        // nothing awaits a LifetimeTask, so there is nobody to rethrow to; carrying on as if it had finished would hide the failure
+        void unhandled_exception () noexcept            { jassertfalse; std::terminate (); }
+
+        bool isOwnerAlive () const                      { return guard == nullptr || guard (); }
+
+        static void* operator new (size_t size)                   { return CoroutineFrameAllocator::allocate (size); }
+        static void operator delete (void* frame, size_t size)    { CoroutineFrameAllocator::deallocate (frame, size); }
+
+    private:
+        using Guard = InplaceFunction<bool(), 16>;
+
+        // (a separate function, because GCC doesn't see Owner's members when this is done in the constructor)
+        template <class Owner>
+        static Guard makeGuard (Owner& owner)
+        {
+            if constexpr (DeclaresWeakRef<Owner>::value)
+                return [weak = typename Owner::WeakRef (&owner)] { return weak.get () != nullptr; };
+            else
+                return nullptr;
+        }
+
+        Guard guard;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+};
+
+/**
+ * Resumes a suspended LifetimeTask once, or destroys it if its owner is gone.
+ * A delay that never fires (cancelled, or dropped at shutdown) destroys the frame too.
+ */
+class LifetimeTaskResumer
+{
+public:
+    explicit LifetimeTaskResumer (LifetimeTask::Handle handleToResume) noexcept : handle (handleToResume) {}
+
+    LifetimeTaskResumer (LifetimeTaskResumer&& other) noexcept
+        : handle (std::exchange (other.handle, nullptr)) {}
+
+    ~LifetimeTaskResumer ()
+    {
+        if (handle)
+            handle.destroy ();
+    }
+
+    void operator() ()
+    {
+        if (auto task = std::exchange (handle, nullptr))
+        {
+            if (task.promise ().isOwnerAlive ())
+                task.resume ();
+            else
+                task.destroy ();
+        }
+    }
+
+private:
+    LifetimeTask::Handle handle;
+
+    JUCE_DECLARE_NON_COPYABLE (LifetimeTaskResumer)
+};
+
+/** The awaitable returned by delayFor (). */
+class LifetimeDelay
+{
+public:
+    LifetimeDelay (int delayMilliseconds, ScopedDelayedCallback* ownerSlot) noexcept
+        : milliseconds (delayMilliseconds), pendingDelay (ownerSlot) {}
+
+    bool await_ready () const noexcept   { return false; }
+
+    void await_suspend (LifetimeTask::Handle task)
+    {
+        auto handle = LifetimeScheduler::callAfterDelay (milliseconds, LifetimeTaskResumer (task));
+
+        if (pendingDelay != nullptr)
+            *pendingDelay = handle;
+    }
+
+    void await_resume () const noexcept {}
+
+private:
+    int milliseconds;
+    ScopedDelayedCallback* pendingDelay;
+};
+
+/** Suspends the calling LifetimeTask for the given time. */
+inline LifetimeDelay delayFor (int milliseconds)
+{
+    return { milliseconds, nullptr };
+}
+
+/** Like delayFor (milliseconds), but the delay (and with it the task) is cancelled when pendingDelay is destroyed. */
+inline LifetimeDelay delayFor (int milliseconds, ScopedDelayedCallback& pendingDelay)
+{
+    return { milliseconds, &pendingDelay };
+}
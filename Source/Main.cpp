@@ -8,6 +8,16 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "AsyncLog.h"
+#include "Trace.h"
+#include "LeakReport.h"
+#include "DeferredDeletionQueue.h"
+#include "SelfDestructingObject.h"
+#include "HeadlessRun.h"
+#include "StartupProfiler.h"
+
+// the first startup milestone, taken while the statics of this file are initialised
+[[maybe_unused]] static const bool staticInitialisationMarked = (StartupProfiler::mark (StartupProfiler::staticInitialisation), true);
 
 //==============================================================================
 class MacrosApplication  : public juce::JUCEApplication
@@ -24,8 +34,22 @@ public:
     void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
+        StartupProfiler::mark (StartupProfiler::initialiseCalled);
+
+        if (HeadlessRun::isRequested (commandLine))
+        {
+            // no window: run the lifetime checks and the stress test, then quit (see HeadlessRun.h)
+            headlessRun = std::make_unique<HeadlessRun> (HeadlessRun::parseOptions (commandLine), [this] (int exitCode)
+            {
+                setApplicationReturnValue (exitCode);
+                quit();
+            });
+
+            return;
+        }
 
         mainWindow.reset (new MainWindow (getApplicationName()));
+        StartupProfiler::mark (StartupProfiler::windowConstructed);
     }
 
     void shutdown() override
@@ -33,6 +57,19 @@ public:
         // Add your application's shutdown code here..
 
         mainWindow = nullptr; // (deletes our window)
+        headlessRun = nullptr;
+
+       #if JUCE_CHECK_MEMORY_LEAKS
+        DeferredDeletionQueue::getInstance ().flush (); // (queued objects aren't leaks)
+        ObjectPool<SelfDestructingObject>::getInstance ().clear (); // (nor are pooled ones)
+        LeakReport::write (LeakReport::getDefaultOutputFile ());
+       #endif
+
+        AsyncLog::getInstance ().shutdown ();
+
+       #if ENABLE_TRACING
+        TraceRecorder::getInstance ().writeJson (TraceRecorder::getDefaultOutputFile ());
+       #endif
     }
 
     //==============================================================================
@@ -93,11 +130,12 @@ public:
         */
 
     private:
-        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainWindow)
+        DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR (MainWindow)
     };
 
 private:
     std::unique_ptr<MainWindow> mainWindow;
+    std::unique_ptr<HeadlessRun> headlessRun;
 };
 
 //==============================================================================
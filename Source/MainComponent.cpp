@@ -1,5 +1,9 @@
 #include "MainComponent.h"
 #include "SelfDestructingObject.h"
+#include "AsyncLog.h"
+#include "Trace.h"
+#include "StartupProfiler.h"
+#include "WeakCallback.h"
 
 //==============================================================================
 MainComponent::MainComponent()
@@ -17,26 +21,32 @@ MainComponent::MainComponent()
      * you'll see a print).
      */
     
-    auto obj = new SelfDestructingObject ();
-    obj->setName ("Self Destructing Object");
+    auto obj = SelfDestructingObject::create ();
+    static const NameAtom objectName ("Self Destructing Object"); // interned once, not on every call
+    obj->setName (objectName);
     
 
 
     //The crash button tries to access the object by checking a normal pointer passed
     crashButton.onClick = [obj](){
+        TRACE_SCOPE ("crashButton.onClick");
         if (obj)
-            DBG ("Name: " << obj->getName ());
+            LOG_INFO ("Name: {}", obj->getName ());
         else
-            DBG ("Object has been deleted");
+            LOG_INFO ("Object has been deleted");
     };
     
-    // the checkButton uses a weak reference for this.
-    checkButton.onClick = [weak = WeakReference<SelfDestructingObject> (obj)] (){
-        if (weak)
-            DBG ("Name: " << weak->getName ());
-        else
-            DBG ("Object has been deleted");
+    // the checkButton uses a weak reference for this, wrapped in a weakCallback.
+    // checkAction holds it inline, and onClick only captures this, so nothing is allocated.
+    checkAction = weakCallback (obj, &SelfDestructingObject::logName)
+                      .orElse ([] { LOG_INFO ("Object has been deleted"); });
+
+    checkButton.onClick = [this] (){
+        TRACE_SCOPE ("checkButton.onClick");
+        checkAction ();
     };
+
+    StartupProfiler::mark (StartupProfiler::mainComponentConstructed);
 }
 
 MainComponent::~MainComponent()
@@ -47,12 +57,18 @@ MainComponent::~MainComponent()
 //==============================================================================
 void MainComponent::paint (juce::Graphics& g)
 {
+    TRACE_SCOPE ("MainComponent::paint");
+    StartupProfiler::mark (StartupProfiler::firstPaint);
+
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 }
 
 void MainComponent::resized()
 {
+    TRACE_SCOPE ("MainComponent::resized");
+    StartupProfiler::mark (StartupProfiler::firstResized);
+
     auto bounds = getLocalBounds ();
     auto b = Rectangle<int> { 100, 25 };
     checkButton.setBounds (bounds.removeFromLeft (bounds.getWidth () / 2).withSizeKeepingCentre(b.getWidth (), b.getHeight ()));
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ShardedLeakDetector.h"
+#include "FixedString.h"
+#include "ProjectVersion.h"
+#include "InplaceFunction.h"
 
 /** 
  * MACROS
@@ -26,7 +30,8 @@
 #endif
 
 // Define a macro that expands to the name of the plugin
-const static inline String PluginName{ IF_EXTENDED ("Extended Plugin", "Normal Plugin") };
+// (a constexpr FixedString is read-only data; a static String would be built before main, see FixedString.h)
+static inline constexpr FixedString PluginName{ IF_EXTENDED ("Extended Plugin", "Normal Plugin") };
 
 
 
@@ -73,6 +78,10 @@ const static inline String PluginName{ IF_EXTENDED ("Extended Plugin", "Normal P
   * The ProjectInfo class provides information about the project, such as the
   * project name, company name, and version string. This information is defined
   * in the Projucer and can be accessed in your code using the ProjectInfo class.
+  * 
+  * To compare versions, don't parse versionString: ProjectVersion (see
+  * ProjectVersion.h) unpacks ProjectInfo::versionNumber at compile time, and
+  * IF_VERSION_AT_LEAST (1, 2, 0, newValue, oldValue) picks a value by version.
   */
 
   static inline void printProjectInfo ()
@@ -80,6 +89,8 @@ const static inline String PluginName{ IF_EXTENDED ("Extended Plugin", "Normal P
       DBG ("projectName " << ProjectInfo::projectName);
       DBG ("companyName " << ProjectInfo::companyName);
       DBG ("versionString " << ProjectInfo::versionString);
+      DBG ("major " << ProjectVersion::current ().majorVersion << ", minor " << ProjectVersion::current ().minorVersion
+           << ", patch " << ProjectVersion::current ().patchVersion);
   }
 
 
@@ -103,8 +114,11 @@ const static inline String PluginName{ IF_EXTENDED ("Extended Plugin", "Normal P
  * juce::ReferenceCountedObject.
  * 
  * To detect memory leaks, JUCE provides a leak detector that can be enabled by
- * using the JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR macro in your class as
- * shown in the example below.
+ * using the JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR macro in your class.
+ * 
+ * This project uses the drop-in DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR
+ * (see ShardedLeakDetector.h) as shown in the example below. It reports the
+ * same leaks, but threads don't have to share one counter per class.
  */
 
 class LeakingObject
@@ -113,7 +127,7 @@ public:
     LeakingObject () = default;
     
 private:
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LeakingObject)
+    DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR (LeakingObject)
 };
 
 
@@ -200,6 +214,8 @@ private:
     TextButton crashButton{ "crash" };
     TextButton deleteButton{ "delete object" };
 
-    // JUCE_HEAVYWEIGHT_LEAK_DETECTOR (classname)
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
+    InplaceFunction<void()> checkAction;
+
+    // build with HEAVYWEIGHT_LEAK_DETECTION=1 to also get the creation stacks of leaked objects
+    DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR (MainComponent)
 };
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Micro Benchmark
+ *
+ * A single timing, like the ones in LifetimeBenchmarks, is good enough to
+ * see whether something is 10 ns or 100 ns. To notice that a primitive got
+ * 15% slower between two releases it takes more: warming up, enough samples
+ * to see the spread, and results that a script can compare.
+ *
+ * MicroBenchmark runs a function repeatedly and summarises the timings:
+ *
+ * MicroBenchmark benchmark;
+ *
+ * benchmark.run ("WeakReference copy", 1000, [&] {
+ *     for (int i = 0; i < 1000; ++i)
+ *         MicroBenchmark::keep (WeakReference<Thing> (weak).get ());
+ * });
+ *
+ * std::cout << benchmark.toJson ();
+ *
+ * The second argument is the number of operations one call of the function
+ * performs; results are per operation. Before measuring, the number of calls
+ * per sample is doubled until a sample takes at least minSampleSeconds, so
+ * that the clock's resolution doesn't matter. Then a few samples are thrown
+ * away (warm-up) and numSamples are kept. Each result has the median, p99,
+ * mean, minimum and maximum nanoseconds per operation, and operations per
+ * second (from the median, which is what regressions should be tracked by:
+ * a single preempted sample moves the mean, but not the median).
+ *
+ * With the default 101 samples, p99 is the second slowest sample.
+ */
+
+class MicroBenchmark
+{
+public:
+    struct Options
+    {
+        int numSamples = 101;
+        int numWarmupSamples = 5;
+        double minSampleSeconds = 0.002;
+    };
+
+    struct Result
+    {
+        String name;
+        int64 operationsPerSample = 0;
+        int numSamples = 0;
+        double medianNanoseconds = 0.0;
+        double p99Nanoseconds = 0.0;
+        double meanNanoseconds = 0.0;
+        double minNanoseconds = 0.0;
+        double maxNanoseconds = 0.0;
+
+        double getOperationsPerSecond () const noexcept   { return medianNanoseconds > 0.0 ? 1.0e9 / medianNanoseconds : 0.0; }
+    };
+
+    MicroBenchmark () = default;
+    explicit MicroBenchmark (Options benchmarkOptions) : options (benchmarkOptions) {}
+
+    /** Only benchmarks whose name contains filter (ignoring case) are run; empty runs all. */
+    void setFilter (const String& newFilter)    { filter = newFilter; }
+
+    /** Called with each result as soon as it is measured. */
+    std::function<void (const Result&)> onResult;
+
+    /** Measures function, which performs operationsPerCall operations per call. */
+    template <typename Function>
+    void run (const String& name, int operationsPerCall, Function&& function)
+    {
+        if (filter.isNotEmpty () && ! name.containsIgnoreCase (filter))
+            return;
+
+        jassert (operationsPerCall > 0);
+
+        int64 callsPerSample = 1;
+
+        while (measureSeconds (callsPerSample, function) < options.minSampleSeconds && callsPerSample < ((int64) 1 << 40))
+            callsPerSample *= 2;
+
+        for (int i = 0; i < options.numWarmupSamples; ++i)
+            measureSeconds (callsPerSample, function);
+
+        auto operationsPerSample = callsPerSample * operationsPerCall;
+        std::vector<double> samples;
+        samples.reserve ((size_t) options.numSamples);
+
+        for (int i = 0; i < options.numSamples; ++i)
+            samples.push_back (measureSeconds (callsPerSample, function) * 1.0e9 / (double) operationsPerSample);
+
+        results.push_back (summarise (name, operationsPerSample, std::move (samples)));
+
+        if (onResult != nullptr)
+            onResult (results.back ());
+    }
+
+    const std::vector<Result>& getResults () const noexcept   { return results; }
+
+    String toJson () const
+    {
+        String json;
+        json << "{\"project\":\"" << ProjectInfo::projectName << "\",\"version\":\"" << ProjectInfo::versionString
+             << "\",\"debug\":" << (isDebugBuild () ? "true" : "false") << ",\"results\":[";
+
+        for (size_t i = 0; i < results.size (); ++i)
+        {
+            auto& r = results[i];
+
+            json << (i == 0 ? "\n" : ",\n")
+                 << "{\"name\":\"" << r.name.replace ("\\", "\\\\").replace ("\"", "\\\"") << "\""
+                 << ",\"samples\":" << r.numSamples
+                 << ",\"operationsPerSample\":" << r.operationsPerSample
+                 << ",\"medianNs\":" << String (r.medianNanoseconds, 3)
+                 << ",\"p99Ns\":" << String (r.p99Nanoseconds, 3)
+                 << ",\"meanNs\":" << String (r.meanNanoseconds, 3)
+                 << ",\"minNs\":" << String (r.minNanoseconds, 3)
+                 << ",\"maxNs\":" << String (r.maxNanoseconds, 3)
+                 << ",\"opsPerSecond\":" << String (r.getOperationsPerSecond (), 0)
+                 << "}";
+        }
+
+        json << "\n]}\n";
+        return json;
+    }
+
+    /** One line per result, for reading in a terminal. */
+    static String formatResult (const Result& r)
+    {
+        return r.name.paddedRight (' ', 52)
+             + ("median " + String (r.medianNanoseconds, 2) + " ns").paddedRight (' ', 20)
+             + ("p99 " + String (r.p99Nanoseconds, 2) + " ns").paddedRight (' ', 20)
+             + String (r.getOperationsPerSecond () / 1.0e6, 2) + " M ops/s";
+    }
+
+    /** Keeps the optimiser from dropping a result that is otherwise unused. */
+    template <typename Type>
+    static void keep (const Type& value) noexcept
+    {
+        sink = sink + (int64) (pointer_sized_int) value;
+    }
+
+    /** For benchmark command lines: ArgumentList only reads values of long options written as --option=value; this also accepts --option value. */
+    static String getOptionValue (const ArgumentList& arguments, StringRef option)
+    {
+        auto value = arguments.getValueForOption (option);
+        auto index = arguments.indexOfOption (option);
+
+        if (value.isEmpty () && index >= 0 && index + 1 < arguments.size ())
+            return arguments[index + 1].text;
+
+        return value;
+    }
+
+    static constexpr bool isDebugBuild () noexcept
+    {
+       #if JUCE_DEBUG
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+private:
+    template <typename Function>
+    static double measureSeconds (int64 numCalls, Function& function)
+    {
+        auto start = Time::getHighResolutionTicks ();
+
+        for (int64 i = 0; i < numCalls; ++i)
+            function ();
+
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks () - start);
+    }
+
+    static Result summarise (const String& name, int64 operationsPerSample, std::vector<double> samples)
+    {
+        std::sort (samples.begin (), samples.end ());
+
+        // nearest rank
+        auto percentile = [&samples] (double p)
+        {
+            auto rank = (size_t) std::ceil (p / 100.0 * (double) samples.size ());
+            return samples[jlimit ((size_t) 1, samples.size (), rank) - 1];
+        };
+
+        Result result;
+        result.name = name;
+        result.operationsPerSample = operationsPerSample;
+        result.numSamples = (int) samples.size ();
+
+        if (samples.empty ())
+            return result;
+
+        result.medianNanoseconds = percentile (50.0);
+        result.p99Nanoseconds = percentile (99.0);
+        result.meanNanoseconds = std::accumulate (samples.begin (), samples.end (), 0.0) / (double) samples.size ();
+        result.minNanoseconds = samples.front ();
+        result.maxNanoseconds = samples.back ();
+        return result;
+    }
+
+    static inline volatile int64 sink = 0;
+
+    Options options;
+    String filter;
+    std::vector<Result> results;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Name Atoms
+ *
+ * When a million objects are given the same name, a juce::String made from a
+ * literal each time means a million identical buffers, and comparing two names
+ * means comparing their characters.
+ *
+ * A NameAtom is a pointer to the one interned copy of a string. Interning
+ * looks the text up in a hash table and only stores it the first time, so
+ * all atoms with the same text share the same immutable String, and two
+ * atoms are equal exactly when their pointers are.
+ *
+ * static const NameAtom objectName ("Self Destructing Object");
+ *
+ * object->setName (objectName);                  // no allocation, no lookup
+ * if (object->getNameAtom () == objectName) ...  // a pointer compare
+ *
+ * auto atom = NameAtom::find ("Some Name");       // O(1), doesn't intern
+ *
+ * Interning is thread safe. Interned strings are never freed, so atoms are
+ * meant for the small set of names a program uses over and over, not for
+ * arbitrary text.
+ */
+
+class NameAtom
+{
+public:
+    /** The empty name. */
+    NameAtom () noexcept : text (&getTable ().empty) {}
+
+    /** Interns the text, or finds the atom it was interned as before. */
+    explicit NameAtom (const String& name) : text (getTable ().intern (name)) {}
+    explicit NameAtom (const char* name) : NameAtom (String (name)) {}
+
+    /** Returns the atom for this text if it has been interned, or the empty atom. */
+    static NameAtom find (const String& name)
+    {
+        NameAtom atom;
+
+        if (auto* interned = getTable ().find (name))
+            atom.text = interned;
+
+        return atom;
+    }
+
+    const String& toString () const noexcept      { return *text; }
+    operator const String& () const noexcept      { return *text; }
+    bool isEmpty () const noexcept                { return text->isEmpty (); }
+
+    bool operator== (const NameAtom& other) const noexcept   { return text == other.text; }
+    bool operator!= (const NameAtom& other) const noexcept   { return text != other.text; }
+
+    /** Atoms hash by address, e.g. as keys of a std::unordered_map. */
+    struct Hash
+    {
+        size_t operator() (const NameAtom& atom) const noexcept   { return std::hash<const String*>() (atom.text); }
+    };
+
+    /** The number of distinct names interned so far. */
+    static size_t getNumInterned ()   { return getTable ().size (); }
+
+private:
+    class Table
+    {
+    public:
+        const String* intern (const String& name)
+        {
+            if (name.isEmpty ())
+                return &empty;
+
+            const std::lock_guard<std::mutex> lock (mutex);
+            return &*strings.insert (name).first;
+        }
+
+        const String* find (const String& name) const
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            auto found = strings.find (name);
+            return found != strings.end () ? &*found : nullptr;
+        }
+
+        size_t size () const
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            return strings.size ();
+        }
+
+        const String empty;
+
+    private:
+        struct StringHash
+        {
+            size_t operator() (const String& s) const noexcept   { return (size_t) s.hashCode64 (); }
+        };
+
+        mutable std::mutex mutex;
+        std::unordered_set<String, StringHash> strings;   // elements never move, so atoms can point at them
+    };
+
+    static Table& getTable ()
+    {
+        static Table table;
+        return table;
+    }
+
+    const String* text;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "IntrusiveWeakReference.h"
+#include "NameAtom.h"
+
+/**
+ * Named Lifetime Object
+ *
+ * Deriving from juce::Component just to get setName () and getName () drags
+ * in everything a Component has - bounds, children, listeners, properties,
+ * its own weak master - for objects that are never shown on screen.
+ * NamedLifetimeObject only has what such objects need: a name and weak
+ * referenceability.
+ *
+ * class Thing : public NamedLifetimeObject<Thing>
+ * {
+ *     DECLARE_SHARDED_LEAK_DETECTOR (Thing)
+ * };
+ *
+ * Thing::WeakRef weak (thing);
+ *
+ * Names are NameAtoms: objects with the same name share one interned
+ * string, and getNameAtom () can be compared by pointer. Setting the name
+ * from an atom skips the lookup, which matters when creating many objects.
+ *
+ * Weak references are IntrusiveWeakReferences, whose control blocks come
+ * from a pool instead of the heap. Pooled classes (see ObjectPool.h) call
+ * invalidateWeakReferences () when an object is reset. Objects are not
+ * copyable. The leak detector stays in the derived class, so that leaks are
+ * reported under its name.
+ */
+
+template <class Derived>
+class NamedLifetimeObject
+{
+public:
+    using WeakRef = IntrusiveWeakReference<Derived>;
+
+    NamedLifetimeObject () = default;
+    explicit NamedLifetimeObject (NameAtom initialName) : name (initialName) {}
+
+    void setName (const String& newName)          { name = NameAtom (newName); }
+    void setName (NameAtom newName) noexcept      { name = newName; }
+
+    const String& getName () const noexcept       { return name.toString (); }
+    NameAtom getNameAtom () const noexcept        { return name; }
+
+protected:
+    ~NamedLifetimeObject () = default;
+
+    /** Nulls all weak references to this object; new ones can be made afterwards. */
+    void invalidateWeakReferences () noexcept   { intrusiveWeakMaster.clear (); }
+
+private:
+    NameAtom name;
+
+    IntrusiveWeakMaster<Derived> intrusiveWeakMaster;
+    friend class IntrusiveWeakReference<Derived>;
+
+    JUCE_DECLARE_NON_COPYABLE (NamedLifetimeObject)
+};
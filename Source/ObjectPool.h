@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeferredDeletionQueue.h"
+
+/**
+ * Object Pool
+ *
+ * Objects that are created and destroyed over and over pay for the
+ * allocation, construction and teardown every time. An ObjectPool keeps
+ * expired objects on a free list instead, and hands them out again:
+ *
+ * auto* object = ObjectPool<Thing>::getInstance ().acquire ();
+ * ...
+ * ObjectPool<Thing>::getInstance ().release (object);   // instead of delete
+ *
+ * A pooled class provides two methods: resetForPool () is called when the
+ * object is released and should bring it back into its freshly constructed
+ * state, prepareForReuse () is called when it is handed out again.
+ *
+ * A recycled object lives at the same address as before, so a plain pointer
+ * to its previous incarnation silently points at the new one. That is why
+ * resetForPool () has to clear the object's weak references (a
+ * NamedLifetimeObject does that with invalidateWeakReferences ()): all weak
+ * references to the old incarnation become null, and new ones refer to the
+ * new incarnation.
+ *
+ * The pool is used on the message thread only. Objects beyond the free list
+ * limit go to the DeferredDeletionQueue, the free ones are deleted at shutdown.
+ */
+
+template <class ObjectType>
+class ObjectPool  : private DeletedAtShutdown
+{
+public:
+    struct Statistics
+    {
+        int64 numAcquired = 0;
+        int64 numReused = 0;
+        int64 numReleased = 0;
+        size_t numFree = 0;
+
+        double getHitRate () const noexcept   { return numAcquired > 0 ? (double) numReused / (double) numAcquired : 0.0; }
+    };
+
+    static ObjectPool& getInstance ()
+    {
+        if (instance == nullptr)
+            instance = new ObjectPool ();
+
+        return *instance;
+    }
+
+    ~ObjectPool () override
+    {
+        clear ();
+        instance = nullptr;
+    }
+
+    /** Returns a recycled object if there is one, or a new one. */
+    ObjectType* acquire ()
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        ++statistics.numAcquired;
+
+        if (freeObjects.empty ())
+            return new ObjectType ();
+
+        auto* object = freeObjects.back ().release ();
+        freeObjects.pop_back ();
+        ++statistics.numReused;
+
+        object->prepareForReuse ();
+        return object;
+    }
+
+    void release (ObjectType* object)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        if (object == nullptr)
+            return;
+
+        ++statistics.numReleased;
+
+        if (freeObjects.size () >= maxFreeObjects)
+        {
+            DeferredDeletionQueue::deleteLater (object);
+            return;
+        }
+
+        object->resetForPool ();
+        freeObjects.emplace_back (object);
+    }
+
+    /** How many released objects are kept; the rest are deleted. */
+    void setMaxFreeObjects (size_t newMaximum)
+    {
+        maxFreeObjects = newMaximum;
+
+        if (freeObjects.size () > maxFreeObjects)
+            freeObjects.resize (maxFreeObjects);
+    }
+
+    /** Deletes all objects on the free list. */
+    void clear ()
+    {
+        freeObjects.clear ();
+    }
+
+    Statistics getStatistics () const noexcept
+    {
+        auto result = statistics;
+        result.numFree = freeObjects.size ();
+        return result;
+    }
+
+    void resetStatistics () noexcept   { statistics = {}; }
+
+private:
+    ObjectPool () = default;
+
+    std::vector<std::unique_ptr<ObjectType>> freeObjects;
+    size_t maxFreeObjects = 100000;
+    Statistics statistics;
+
+    static inline ObjectPool* instance = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE (ObjectPool)
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Pooled Weak References
+ *
+ * The first WeakReference to an object makes its Master allocate a small
+ * SharedPointer with global new, and the last reference deletes it again.
+ * When objects and references are created by the thousand, often on several
+ * threads, that is a lot of traffic through the general-purpose allocator for
+ * blocks that all have the same size.
+ *
+ * WeakReference has a second template parameter for the base class of its
+ * SharedPointer. PooledReferenceCountedObject is a ReferenceCountedObject
+ * with its own operator new and delete, which take the blocks from a
+ * FixedSizeAllocator, so a class using DECLARE_POOLED_WEAK_REFERENCEABLE
+ * gets its SharedPointers from there:
+ *
+ * class MyObject
+ * {
+ *     DECLARE_POOLED_WEAK_REFERENCEABLE (MyObject)
+ * };
+ *
+ * PooledWeakReference<MyObject> weak (obj);   // a WeakReference<MyObject, PooledReferenceCountedObject>
+ *
+ * The allocator keeps a small free list per thread, so most allocations and
+ * deallocations don't touch any shared state; only when a thread's list runs
+ * empty or overflows is a batch of blocks moved from or to a shared depot.
+ * Blocks are never given back to the system (they are reused instead).
+ */
+
+template <size_t blockSize>
+class FixedSizeAllocator
+{
+public:
+    static_assert (blockSize >= sizeof (void*) && blockSize % alignof (std::max_align_t) == 0,
+                   "blocks must hold a pointer and keep the default alignment");
+
+    static void* allocate ()
+    {
+        auto& cache = threadCache;
+
+        if (cache.isFlushed)
+        {
+            // the thread is exiting and its cache has already been flushed: a refilled batch would never be given back
+            int numTaken = 0;
+            return getDepot ().take (numTaken, 1);
+        }
+
+        if (cache.head == nullptr)
+            refill (cache);
+
+        auto* block = cache.head;
+        cache.head = block->next;
+        --cache.count;
+        return block;
+    }
+
+    static void deallocate (void* pointer) noexcept
+    {
+        auto& cache = threadCache;
+
+        if (cache.isFlushed)
+        {
+            // the thread is exiting and its cache has already been flushed
+            getDepot ().give (static_cast<FreeBlock*> (pointer), static_cast<FreeBlock*> (pointer));
+            return;
+        }
+
+        if (cache.count == 0)
+            registerFlusher ();
+
+        auto* block = static_cast<FreeBlock*> (pointer);
+        block->next = cache.head;
+        cache.head = block;
+
+        if (++cache.count > maxCachedBlocks)
+            giveBatchToDepot (cache);
+    }
+
+    /** The number of blocks obtained from the system so far, by all threads. */
+    static size_t getNumBlocks ()
+    {
+        return getDepot ().getNumBlocks ();
+    }
+
+    static constexpr int batchSize = 128;
+    static constexpr int maxCachedBlocks = 2 * batchSize;
+    static constexpr size_t blocksPerChunk = jmax ((size_t) 64, (size_t) 65536 / blockSize);
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    /** Plain data, so that it is still usable while the thread is being torn down. */
+    struct ThreadCache
+    {
+        FreeBlock* head;
+        int count;
+        bool isFlushed;
+    };
+
+    static inline thread_local ThreadCache threadCache { nullptr, 0, false };
+
+    /** Returns a thread's cached blocks to the depot when the thread exits. */
+    struct CacheFlusher
+    {
+        ~CacheFlusher ()
+        {
+            auto& cache = threadCache;
+
+            if (cache.head != nullptr)
+            {
+                auto* last = cache.head;
+
+                while (last->next != nullptr)
+                    last = last->next;
+
+                getDepot ().give (cache.head, last);
+            }
+
+            cache = { nullptr, 0, true };
+        }
+    };
+
+    static void registerFlusher ()
+    {
+        thread_local CacheFlusher flusher;
+        ignoreUnused (flusher);
+    }
+
+    class Depot
+    {
+    public:
+        /** Takes up to maxToTake blocks, allocating a new chunk when there are none. */
+        FreeBlock* take (int& numTaken, int maxToTake = batchSize)
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+
+            if (head == nullptr)
+                addChunk ();
+
+            auto* first = head;
+            auto* last = head;
+            numTaken = 1;
+
+            while (numTaken < maxToTake && last->next != nullptr)
+            {
+                last = last->next;
+                ++numTaken;
+            }
+
+            head = last->next;
+            last->next = nullptr;
+            return first;
+        }
+
+        void give (FreeBlock* first, FreeBlock* last) noexcept
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            last->next = head;
+            head = first;
+        }
+
+        size_t getNumBlocks ()
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+            return numChunks * blocksPerChunk;
+        }
+
+    private:
+        void addChunk ()
+        {
+            auto* chunk = static_cast<char*> (::operator new (blocksPerChunk * blockSize));
+
+            for (size_t i = blocksPerChunk; i-- > 0;)
+            {
+                auto* block = reinterpret_cast<FreeBlock*> (chunk + i * blockSize);
+                block->next = head;
+                head = block;
+            }
+
+            ++numChunks;
+        }
+
+        std::mutex mutex;
+        FreeBlock* head = nullptr;
+        size_t numChunks = 0;
+    };
+
+    static Depot& getDepot ()
+    {
+        // never deleted: blocks may still be freed while other statics are destroyed
+        static Depot& depot = *new Depot ();
+        return depot;
+    }
+
+    static void refill (ThreadCache& cache)
+    {
+        registerFlusher ();
+
+        int numTaken = 0;
+        cache.head = getDepot ().take (numTaken);
+        cache.count = numTaken;
+    }
+
+    static void giveBatchToDepot (ThreadCache& cache) noexcept
+    {
+        auto* first = cache.head;
+        auto* last = first;
+
+        for (int i = 1; i < batchSize; ++i)
+            last = last->next;
+
+        cache.head = last->next;
+        cache.count -= batchSize;
+        getDepot ().give (first, last);
+    }
+};
+
+//==============================================================================
+/** A ReferenceCountedObject whose instances are allocated by a FixedSizeAllocator. */
+class PooledReferenceCountedObject  : public ReferenceCountedObject
+{
+public:
+    static constexpr size_t blockSize = 32;
+    using Allocator = FixedSizeAllocator<blockSize>;
+
+    static void* operator new (size_t size)
+    {
+        return size <= blockSize ? Allocator::allocate () : ::operator new (size);
+    }
+
+    static void operator delete (void* pointer, size_t size) noexcept
+    {
+        if (size <= blockSize)
+            Allocator::deallocate (pointer);
+        else
+            ::operator delete (pointer);
+    }
+
+protected:
+    PooledReferenceCountedObject () = default;
+};
+
+template <class ObjectType>
+using PooledWeakReference = WeakReference<ObjectType, PooledReferenceCountedObject>;
+
+#define DECLARE_POOLED_WEAK_REFERENCEABLE(Class) \
+    struct WeakRefMaster  : public juce::WeakReference<Class, PooledReferenceCountedObject>::Master { ~WeakRefMaster() { this->clear(); } }; \
+    WeakRefMaster masterReference; \
+    friend class juce::WeakReference<Class, PooledReferenceCountedObject>;
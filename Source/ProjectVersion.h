@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <string_view>
+
+/**
+ * Project Version
+ *
+ * ProjectInfo::versionString is only good for printing: comparing versions
+ * by parsing it means doing so at runtime, every time. ProjectInfo also has
+ * versionNumber, the same version packed as 0xMMmmpp (a byte each for
+ * major, minor and patch), which is a compile time constant. ProjectVersion
+ * unpacks it, and compares with other versions, at compile time:
+ *
+ * constexpr auto version = ProjectVersion::current ();   // e.g. { 1, 2, 0 }
+ *
+ * if constexpr (ProjectVersion::current () >= ProjectVersion ("1.2.0"))
+ *     useNewBehaviour ();
+ *
+ * Two macros choose between alternatives by version:
+ *
+ * auto timeout = IF_VERSION_AT_LEAST (1, 2, 0, 500, 1000);
+ *
+ * #if PROJECT_VERSION_AT_LEAST (1, 2, 0)
+ *     ...
+ * #endif
+ *
+ * IF_VERSION_AT_LEAST is a conditional on a compile time constant: only the
+ * selected alternative is evaluated, and with constant alternatives the whole
+ * expression is a constant. Both alternatives are compiled, so they need a
+ * common type. PROJECT_VERSION_AT_LEAST works in #if, so the code it guards
+ * doesn't even have to compile in other versions. It uses
+ * JUCE_APP_VERSION_HEX, which the Projucer adds to the preprocessor
+ * definitions of every exporter.
+ */
+
+struct ProjectVersion
+{
+    constexpr ProjectVersion (int major, int minor, int patch) noexcept
+        : majorVersion (major), minorVersion (minor), patchVersion (patch) {}
+
+    /** Parses "major.minor.patch" (missing parts are 0); at compile time when given a literal. */
+    constexpr explicit ProjectVersion (std::string_view text) noexcept
+    {
+        int* parts[] = { &majorVersion, &minorVersion, &patchVersion };
+        size_t part = 0;
+
+        for (auto c : text)
+        {
+            if (c == '.')
+            {
+                if (++part == 3)
+                    break;
+            }
+            else if (c >= '0' && c <= '9')
+            {
+                *parts[part] = *parts[part] * 10 + (c - '0');
+            }
+        }
+    }
+
+    /** Unpacks 0xMMmmpp, the format of ProjectInfo::versionNumber and JUCE_APP_VERSION_HEX. */
+    static constexpr ProjectVersion fromHex (int hex) noexcept
+    {
+        return { (hex >> 16) & 0xff, (hex >> 8) & 0xff, hex & 0xff };
+    }
+
+    /** The version of this project, as set in the Projucer. */
+    static constexpr ProjectVersion current () noexcept
+    {
+        return fromHex (ProjectInfo::versionNumber);
+    }
+
+    /** Packed as 0xMMmmpp; packed versions compare like the versions themselves. */
+    constexpr int toHex () const noexcept
+    {
+        return (majorVersion << 16) | (minorVersion << 8) | patchVersion;
+    }
+
+    String toString () const
+    {
+        return String (majorVersion) + "." + String (minorVersion) + "." + String (patchVersion);
+    }
+
+    constexpr bool operator== (ProjectVersion other) const noexcept   { return toHex () == other.toHex (); }
+    constexpr bool operator!= (ProjectVersion other) const noexcept   { return toHex () != other.toHex (); }
+    constexpr bool operator<  (ProjectVersion other) const noexcept   { return toHex () <  other.toHex (); }
+    constexpr bool operator<= (ProjectVersion other) const noexcept   { return toHex () <= other.toHex (); }
+    constexpr bool operator>  (ProjectVersion other) const noexcept   { return toHex () >  other.toHex (); }
+    constexpr bool operator>= (ProjectVersion other) const noexcept   { return toHex () >= other.toHex (); }
+
+    int majorVersion = 0, minorVersion = 0, patchVersion = 0;
+};
+
+#define IF_VERSION_AT_LEAST(major, minor, patch, newValue, oldValue) \
+    ((ProjectVersion::current () >= ProjectVersion (major, minor, patch)) ? (newValue) : (oldValue))
+
+#ifdef JUCE_APP_VERSION_HEX
+ #define PROJECT_VERSION_AT_LEAST(major, minor, patch) \
+    (JUCE_APP_VERSION_HEX >= (((major) << 16) | ((minor) << 8) | (patch)))
+
+ static_assert (JUCE_APP_VERSION_HEX == ProjectInfo::versionNumber, "JUCE_APP_VERSION_HEX and ProjectInfo disagree - resave the project");
+#endif
@@ -1,21 +1,89 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "LifetimeScheduler.h"
+#include "DeferredDeletionQueue.h"
+#include "ObjectPool.h"
+#include "NamedLifetimeObject.h"
+#include "LifetimeTask.h"
+#include "AsyncLog.h"
+#include "Trace.h"
+#include "ShardedLeakDetector.h"
 
-class SelfDestructingObject : public Component
+class SelfDestructingObject : public NamedLifetimeObject<SelfDestructingObject>
 {
 public:
+    /**
+     * With deleteOnExpiry, an expired object is deleted. With pooled, it is
+     * reset and returned to ObjectPool<SelfDestructingObject> instead, and
+     * create () hands it out again.
+     */
+    enum class LifetimeMode
+    {
+        deleteOnExpiry,
+        pooled
+    };
+
     SelfDestructingObject ()
     {
-        Timer::callAfterDelay (Random::getSystemRandom ().nextInt (3000), [weak = WeakReference (this)](){
-            if (weak)
-                delete weak.get ();
-            
-            DBG ("Deleted object");
-        });
+        startLifetime ();
+    }
+
+    /** Creates an object according to the current lifetime mode. */
+    static SelfDestructingObject* create ()
+    {
+        if (lifetimeMode == LifetimeMode::deleteOnExpiry)
+            return new SelfDestructingObject ();
+
+        auto* object = ObjectPool<SelfDestructingObject>::getInstance ().acquire ();
+        object->returnsToPool = true;
+        return object;
+    }
+
+    static void setLifetimeMode (LifetimeMode newMode) noexcept   { lifetimeMode = newMode; }
+    static LifetimeMode getLifetimeMode () noexcept               { return lifetimeMode; }
+
+    void logName () const                                         { LOG_INFO ("Name: {}", getName ()); }
+
+    //==============================================================================
+    /** Called by the ObjectPool when the object expired. */
+    void resetForPool ()
+    {
+        invalidateWeakReferences ();
+        setName (NameAtom ());
+    }
+
+    /** Called by the ObjectPool when the object is handed out again. */
+    void prepareForReuse ()
+    {
+        startLifetime ();
     }
 
 private:
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SelfDestructingObject)
-    JUCE_DECLARE_WEAK_REFERENCEABLE (SelfDestructingObject)
+    void startLifetime ()
+    {
+        runLifetime ();
+    }
+
+    LifetimeTask runLifetime ()
+    {
+        // if the object is deleted before it expires, the delay is cancelled and this task destroyed
+        co_await delayFor (LifetimeEnvironment::nextLifetime (), expiry);
+
+        TRACE_SCOPE ("SelfDestructingObject expiry");
+
+        if (returnsToPool)
+            ObjectPool<SelfDestructingObject>::getInstance ().release (this);
+        else
+            DeferredDeletionQueue::deleteLater (this);
+
+        LOG_DEBUG ("Object expired");
+    }
+
+    ScopedDelayedCallback expiry;
+    bool returnsToPool = false;
+
+    static inline LifetimeMode lifetimeMode = LifetimeMode::deleteOnExpiry;
+
+    DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR (SelfDestructingObject)
 };
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StackLeakDetector.h"
+
+/**
+ * Sharded Leak Detector
+ *
+ * JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR keeps one atomic counter per
+ * class. When many threads create and destroy objects of the same class,
+ * they all fight over the cache line of that counter.
+ *
+ * DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR is a drop-in replacement
+ * that spreads the counter over cache-line sized shards: each thread counts
+ * in its own shard, and the shards are only added up when someone asks for
+ * the number of live objects, or at shutdown. The diagnostics are the same
+ * as JUCE's - a leak assertion when the program ends with live objects.
+ *
+ * An object may well be created on one thread and deleted on another, so a
+ * single shard can go negative; only the sum is meaningful. That's also why
+ * a dangling deletion can only be reported when the shards are summed up,
+ * and not at the moment it happens.
+ *
+ * Like JUCE's leak detector, it is only active when JUCE_CHECK_MEMORY_LEAKS
+ * is enabled (by default in debug builds). With HEAVYWEIGHT_LEAK_DETECTION
+ * enabled as well, the creation stacks of leaked objects are reported too
+ * (see StackLeakDetector.h).
+ *
+ * Each class also counts its constructions and samples its peak number of
+ * live objects; LeakReport.h writes these numbers to a file at shutdown.
+ * The macro registers the class during static initialisation, so classes
+ * that never had an object constructed are listed as well.
+ */
+
+class LeakDetectorShards
+{
+public:
+    static constexpr int numShards = 64;
+
+    /** Every thread gets its own shard index (until there are more threads than shards). */
+    static int getShardForThisThread () noexcept
+    {
+        thread_local const int shard = nextShard.fetch_add (1, std::memory_order_relaxed) & (numShards - 1);
+        return shard;
+    }
+
+    struct alignas (64) Shard
+    {
+        std::atomic<int64> count { 0 };
+        std::atomic<int64> numConstructed { 0 };
+    };
+
+private:
+    static inline std::atomic<int> nextShard { 0 };
+};
+
+/** What the sharded detector knows about one class. */
+struct LeakDetectorStatistics
+{
+    const char* className;
+    size_t objectSize;
+    int64 numLive;
+    int64 sampledPeakLive;  // short spikes may be missed, see LeakCounter::objectCreated ()
+    int64 numConstructed;
+};
+
+/**
+ * Every class with a sharded leak detector registers here during static
+ * initialisation (or at the latest when its first object is created), so
+ * that all of them can be listed at shutdown (see LeakReport.h).
+ */
+class LeakDetectorRegistry
+{
+public:
+    using StatisticsFunction = LeakDetectorStatistics (*) ();
+
+    static LeakDetectorRegistry& getInstance ()
+    {
+        static LeakDetectorRegistry registry;
+        return registry;
+    }
+
+    void add (StatisticsFunction function)
+    {
+        const std::lock_guard<std::mutex> lock (mutex);
+        functions.push_back (function);
+    }
+
+    /** One entry per registered class, sorted by class name. */
+    std::vector<LeakDetectorStatistics> getStatistics () const
+    {
+        std::vector<LeakDetectorStatistics> result;
+
+        {
+            const std::lock_guard<std::mutex> lock (mutex);
+
+            for (auto function : functions)
+                result.push_back (function ());
+        }
+
+        std::sort (result.begin (), result.end (), [] (const auto& a, const auto& b)
+        {
+            return std::strcmp (a.className, b.className) < 0;
+        });
+
+        return result;
+    }
+
+private:
+    LeakDetectorRegistry () = default;
+
+    mutable std::mutex mutex;
+    std::vector<StatisticsFunction> functions;
+
+    JUCE_DECLARE_NON_COPYABLE (LeakDetectorRegistry)
+};
+
+//==============================================================================
+template <class OwnerClass>
+class ShardedLeakedObjectDetector
+{
+public:
+    ShardedLeakedObjectDetector () noexcept                                       { getCounter ().objectCreated (); }
+    ShardedLeakedObjectDetector (const ShardedLeakedObjectDetector&) noexcept     { getCounter ().objectCreated (); }
+    ShardedLeakedObjectDetector& operator= (const ShardedLeakedObjectDetector&) noexcept = default;
+
+    ~ShardedLeakedObjectDetector ()                                               { getCounter ().objectDeleted (); }
+
+    /** Adds the class to the LeakDetectorRegistry; DECLARE_SHARDED_LEAK_DETECTOR calls this during static initialisation. */
+    static bool registerClass ()
+    {
+        getCounter ();
+        return true;
+    }
+
+    /** Adds up all shards. Exact if no other thread is creating or deleting objects at the same time. */
+    static int64 getNumLiveObjects () noexcept
+    {
+        return getCounter ().sum ();
+    }
+
+    static LeakDetectorStatistics getStatistics () noexcept
+    {
+        auto& counter = getCounter ();
+        auto numLive = counter.sum ();
+
+        return { getLeakedObjectClassName (), sizeof (OwnerClass), numLive,
+                 jmax (numLive, counter.peak.load (std::memory_order_relaxed)), counter.getNumConstructed () };
+    }
+
+private:
+    class LeakCounter
+    {
+    public:
+        LeakCounter ()
+        {
+            LeakDetectorRegistry::getInstance ().add (&ShardedLeakedObjectDetector::getStatistics);
+        }
+
+        ~LeakCounter ()
+        {
+            auto numObjects = sum ();
+
+            if (numObjects > 0)
+            {
+                // If you hit this, then you've leaked one or more objects of the type specified by
+                // the 'OwnerClass' template parameter - the name should have been printed by the line above.
+                DBG ("*** Leaked objects detected: " << numObjects << " instance(s) of class " << getLeakedObjectClassName ());
+                jassertfalse;
+            }
+            else if (numObjects < 0)
+            {
+                // More objects were deleted than created, so something has been deleted twice.
+                DBG ("*** Dangling pointer deletion! Class: " << getLeakedObjectClassName ());
+                jassertfalse;
+            }
+        }
+
+        void objectCreated () noexcept
+        {
+            auto& shard = shards[LeakDetectorShards::getShardForThisThread ()];
+            shard.count.fetch_add (1, std::memory_order_relaxed);
+
+            // summing all shards is too slow for every construction, so the peak is only sampled: at each
+            // shard's first peakSampleInterval constructions, then at every peakSampleInterval-th one
+            auto numConstructed = shard.numConstructed.fetch_add (1, std::memory_order_relaxed) + 1;
+
+            if (numConstructed <= peakSampleInterval || numConstructed % peakSampleInterval == 0)
+                updatePeak (sum ());
+        }
+
+        void objectDeleted () noexcept
+        {
+            shards[LeakDetectorShards::getShardForThisThread ()].count.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+        int64 sum () const noexcept
+        {
+            int64 total = 0;
+
+            for (auto& shard : shards)
+                total += shard.count.load (std::memory_order_relaxed);
+
+            return total;
+        }
+
+        int64 getNumConstructed () const noexcept
+        {
+            int64 total = 0;
+
+            for (auto& shard : shards)
+                total += shard.numConstructed.load (std::memory_order_relaxed);
+
+            return total;
+        }
+
+        std::atomic<int64> peak { 0 };
+
+    private:
+        static constexpr int64 peakSampleInterval = 64;
+
+        void updatePeak (int64 numLive) noexcept
+        {
+            auto current = peak.load (std::memory_order_relaxed);
+
+            while (numLive > current && ! peak.compare_exchange_weak (current, numLive, std::memory_order_relaxed))
+            {}
+        }
+
+        LeakDetectorShards::Shard shards[LeakDetectorShards::numShards];
+    };
+
+    static const char* getLeakedObjectClassName ()
+    {
+        return OwnerClass::getLeakedObjectClassName ();
+    }
+
+    static LeakCounter& getCounter () noexcept
+    {
+        static LeakCounter counter;
+        return counter;
+    }
+};
+
+#if JUCE_CHECK_MEMORY_LEAKS && HEAVYWEIGHT_LEAK_DETECTION
+ #define DECLARE_SHARDED_LEAK_DETECTOR(OwnerClass) \
+    friend class ShardedLeakedObjectDetector<OwnerClass>; \
+    static const char* getLeakedObjectClassName () noexcept { return #OwnerClass; } \
+    static inline const bool JUCE_JOIN_MACRO (shardedLeakDetectorRegistered, __LINE__) = ShardedLeakedObjectDetector<OwnerClass>::registerClass (); \
+    ShardedLeakedObjectDetector<OwnerClass> JUCE_JOIN_MACRO (shardedLeakDetector, __LINE__); \
+    HEAVYWEIGHT_LEAK_DETECTOR_MEMBER (OwnerClass)
+#elif JUCE_CHECK_MEMORY_LEAKS
+ #define DECLARE_SHARDED_LEAK_DETECTOR(OwnerClass) \
+    friend class ShardedLeakedObjectDetector<OwnerClass>; \
+    static const char* getLeakedObjectClassName () noexcept { return #OwnerClass; } \
+    static inline const bool JUCE_JOIN_MACRO (shardedLeakDetectorRegistered, __LINE__) = ShardedLeakedObjectDetector<OwnerClass>::registerClass (); \
+    ShardedLeakedObjectDetector<OwnerClass> JUCE_JOIN_MACRO (shardedLeakDetector, __LINE__);
+#else
+ #define DECLARE_SHARDED_LEAK_DETECTOR(OwnerClass)
+#endif
+
+#define DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR(className) \
+    JUCE_DECLARE_NON_COPYABLE (className) \
+    DECLARE_SHARDED_LEAK_DETECTOR (className)
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Slot References
+ *
+ * A juce::WeakReference needs a heap allocated SharedPointer per referenced
+ * object (created lazily by the Master that JUCE_DECLARE_WEAK_REFERENCEABLE
+ * adds to the class) and every check has to chase the pointer to it.
+ *
+ * A SlotReference is a generational handle instead: every object of a class
+ * that uses DECLARE_SLOT_REFERENCEABLE occupies one slot in a contiguous table
+ * for its lifetime. A reference stores the slot index and the generation the
+ * slot had when the reference was taken. When the object dies, the slot's
+ * generation is bumped, so all outstanding references stop matching - the
+ * check is a single compare in the table, and no per-object allocation is
+ * needed.
+ *
+ * class MyObject
+ * {
+ *     DECLARE_SLOT_REFERENCEABLE (MyObject)
+ * };
+ *
+ * SlotReference<MyObject> ref (obj);
+ * if (ref)
+ *     ref->doSomething ();
+ *
+ * A slot whose generation has run out is retired instead of reused, so an
+ * old reference can never match a later object in the same slot. The table
+ * is never destroyed, so objects that are still alive during static
+ * destruction can unregister safely.
+ *
+ * Just like WeakReference, this is not thread safe: create, check and delete
+ * the objects on the same thread (usually the message thread).
+ */
+
+template <class ObjectType>
+class SlotTable
+{
+public:
+    struct Handle
+    {
+        uint32 index = invalidIndex;
+        uint32 generation = 0;
+    };
+
+    static SlotTable& getInstance ()
+    {
+        // deliberately leaked: it has to outlive every registered object, including static ones
+        static auto* table = new SlotTable ();
+        return *table;
+    }
+
+    Handle acquire (ObjectType* object)
+    {
+        if (firstFree == invalidIndex)
+        {
+            slots.push_back ({ nullptr, 1, invalidIndex });
+            firstFree = (uint32) slots.size () - 1;
+        }
+
+        auto index = firstFree;
+        auto& slot = slots[index];
+
+        firstFree = slot.nextFree;
+        slot.object = object;
+        slot.nextFree = invalidIndex;
+
+        return { index, slot.generation };
+    }
+
+    void release (Handle handle) noexcept
+    {
+        jassert (lookup (handle) != nullptr);
+
+        auto& slot = slots[handle.index];
+        slot.object = nullptr;
+        ++slot.generation;
+
+        // a wrapped generation would let old handles match again, so the slot is never handed out after the last one
+        if (slot.generation == retiredGeneration)
+            return;
+
+        slot.nextFree = firstFree;
+        firstFree = handle.index;
+    }
+
+    ObjectType* lookup (Handle handle) const noexcept
+    {
+        if (handle.index >= slots.size ())
+            return nullptr;
+
+        auto& slot = slots[handle.index];
+        return slot.generation == handle.generation ? slot.object : nullptr;
+    }
+
+    size_t getNumSlots () const noexcept { return slots.size (); }
+
+    static constexpr uint32 invalidIndex = 0xffffffff;
+    static constexpr uint32 retiredGeneration = 0xffffffff;
+
+private:
+    SlotTable () = default;
+
+    struct Slot
+    {
+        ObjectType* object;
+        uint32 generation;
+        uint32 nextFree;
+    };
+
+    std::vector<Slot> slots;
+    uint32 firstFree = invalidIndex;
+
+    JUCE_DECLARE_NON_COPYABLE (SlotTable)
+};
+
+/** Occupies a slot for the lifetime of the object it's a member of. */
+template <class ObjectType>
+class SlotRegistration
+{
+public:
+    explicit SlotRegistration (ObjectType* owner)
+        : handle (SlotTable<ObjectType>::getInstance ().acquire (owner)) {}
+
+    ~SlotRegistration () { SlotTable<ObjectType>::getInstance ().release (handle); }
+
+    typename SlotTable<ObjectType>::Handle getHandle () const noexcept { return handle; }
+
+private:
+    typename SlotTable<ObjectType>::Handle handle;
+
+    JUCE_DECLARE_NON_COPYABLE (SlotRegistration)
+};
+
+/** A drop-in alternative to WeakReference for classes declared with DECLARE_SLOT_REFERENCEABLE. */
+template <class ObjectType>
+class SlotReference
+{
+public:
+    SlotReference () = default;
+    SlotReference (ObjectType* object) : handle (getHandleFor (object)) {}
+
+    SlotReference& operator= (ObjectType* object) { handle = getHandleFor (object); return *this; }
+
+    ObjectType* get () const noexcept               { return SlotTable<ObjectType>::getInstance ().lookup (handle); }
+    operator ObjectType* () const noexcept          { return get (); }
+    ObjectType* operator-> () const noexcept        { return get (); }
+
+    bool operator== (ObjectType* object) const noexcept { return get () == object; }
+    bool operator!= (ObjectType* object) const noexcept { return get () != object; }
+
+    /** True if this referred to an object that has since been deleted. */
+    bool wasObjectDeleted () const noexcept
+    {
+        return handle.index != SlotTable<ObjectType>::invalidIndex && get () == nullptr;
+    }
+
+private:
+    static typename SlotTable<ObjectType>::Handle getHandleFor (ObjectType* object) noexcept
+    {
+        return object != nullptr ? object->slotRegistration.getHandle () : typename SlotTable<ObjectType>::Handle {};
+    }
+
+    typename SlotTable<ObjectType>::Handle handle;
+};
+
+#define DECLARE_SLOT_REFERENCEABLE(Class) \
+    SlotRegistration<Class> slotRegistration { this }; \
+    friend class SlotReference<Class>;
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_WINDOWS
+ // declared as in winnt.h; including windows.h here would bring its macros and its ::Rectangle into every file that includes this one
+ extern "C" __declspec(dllimport) unsigned short __stdcall RtlCaptureStackBackTrace (unsigned long framesToSkip, unsigned long framesToCapture,
+                                                                                     void** backTrace, unsigned long* backTraceHash);
+#else
+ #include <pthread.h>
+ #include <execinfo.h>
+#endif
+
+/**
+ * Heavyweight Leak Detector
+ *
+ * The leak detector tells you that objects leaked, but not where they were
+ * created. JUCE's heavyweight detector answers that by storing a formatted
+ * backtrace per object, which is far too slow for objects that are created
+ * by the thousand.
+ *
+ * DECLARE_HEAVYWEIGHT_LEAK_DETECTOR keeps the construction cost small:
+ *
+ * - the stack is captured by walking the frame pointers into a fixed buffer
+ *   (RtlCaptureStackBackTrace on Windows) - no allocation, no symbols
+ * - identical stacks are stored only once: they are hashed and interned in a
+ *   fixed size, lock-free table, and each object just remembers the index of
+ *   its stack there, while the table counts live objects per stack
+ * - the addresses are only turned into symbols when a leak is reported
+ *
+ * The frame walk needs frame pointers, so build soak-test configurations with
+ * -fno-omit-frame-pointer (/Oy- on MSVC); without them stacks are cut short.
+ * Building with HEAVYWEIGHT_LEAK_DETECTION=1 adds this detector to every class
+ * that uses DECLARE_NON_COPYABLE_WITH_SHARDED_LEAK_DETECTOR.
+ */
+
+#ifndef HEAVYWEIGHT_LEAK_DETECTION
+ #define HEAVYWEIGHT_LEAK_DETECTION 0
+#endif
+
+#if JUCE_MSVC
+ #define STACK_CAPTURE_NOINLINE __declspec(noinline)
+#else
+ #define STACK_CAPTURE_NOINLINE __attribute__((noinline))
+#endif
+
+class StackTable
+{
+public:
+    static constexpr int maxFrames = 24;
+    static constexpr uint32 capacity = 16384;
+    static constexpr uint32 overflowIndex = 0;
+
+    static StackTable& getInstance ()
+    {
+        static StackTable table;
+        return table;
+    }
+
+    /** Captures the caller's stack and returns the index of its (shared) entry in the table. */
+    STACK_CAPTURE_NOINLINE uint32 captureAndIntern (const void* owner)
+    {
+        void* frames[maxFrames];
+        auto numFrames = captureFrames (frames, maxFrames);
+
+        return intern (owner, frames, numFrames);
+    }
+
+    void objectCreated (uint32 index) noexcept     { stacks[index].numLive.fetch_add (1, std::memory_order_relaxed); }
+    void objectDeleted (uint32 index) noexcept     { stacks[index].numLive.fetch_sub (1, std::memory_order_relaxed); }
+
+    /** Prints the creation stacks of all live objects of one class, symbolicating them only now. */
+    void reportLeaks (const void* owner, const char* className, int maxStacksToPrint = 10) const
+    {
+        int numPrinted = 0;
+
+        for (uint32 i = 1; i < capacity && numPrinted < maxStacksToPrint; ++i)
+        {
+            auto& stack = stacks[i];
+
+            if (! stack.isReady.load (std::memory_order_acquire) || stack.owner != owner)
+                continue;
+
+            auto numLive = stack.numLive.load (std::memory_order_relaxed);
+
+            if (numLive <= 0)
+                continue;
+
+            DBG ("*** " << numLive << " leaked instance(s) of class " << className << " created at:");
+            DBG (symbolicate (stack.frames, stack.numFrames));
+            ++numPrinted;
+        }
+
+        if (stacks[overflowIndex].numLive.load () > 0)
+            DBG ("*** (some leaked objects were created from stacks that didn't fit into the table)");
+    }
+
+private:
+    StackTable () = default;
+
+    struct Stack
+    {
+        std::atomic<uint64> hash { 0 };
+        std::atomic<bool> isReady { false };
+        const void* owner = nullptr;
+        int numFrames = 0;
+        void* frames[maxFrames];
+        std::atomic<int64> numLive { 0 };
+    };
+
+    static uint64 hashFrames (const void* owner, void* const* frames, int numFrames) noexcept
+    {
+        // one xor-multiply per word, then an avalanche so that the low bits used for the index depend on every frame
+        uint64 hash = 0xcbf29ce484222325ull;
+
+        auto mix = [&hash] (uint64 value)
+        {
+            hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+        };
+
+        mix ((uint64) (pointer_sized_uint) owner);
+
+        for (int i = 0; i < numFrames; ++i)
+            mix ((uint64) (pointer_sized_uint) frames[i]);
+
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+
+        return hash != 0 ? hash : 1;
+    }
+
+    uint32 intern (const void* owner, void* const* frames, int numFrames) noexcept
+    {
+        auto hash = hashFrames (owner, frames, numFrames);
+
+        for (uint32 probe = 0; probe < capacity; ++probe)
+        {
+            auto index = (uint32) ((hash + probe) & (capacity - 1));
+
+            if (index == overflowIndex)
+                continue;
+
+            auto& stack = stacks[index];
+            auto existing = stack.hash.load (std::memory_order_acquire);
+
+            if (existing == hash)
+                return index;
+
+            if (existing == 0 && stack.hash.compare_exchange_strong (existing, hash, std::memory_order_acq_rel))
+            {
+                stack.owner = owner;
+                stack.numFrames = numFrames;
+                std::copy (frames, frames + numFrames, stack.frames);
+                stack.isReady.store (true, std::memory_order_release);
+                return index;
+            }
+
+            if (existing == hash)
+                return index;
+        }
+
+        return overflowIndex;
+    }
+
+    STACK_CAPTURE_NOINLINE static int captureFrames (void** frames, int maxNumFrames) noexcept
+    {
+       #if JUCE_WINDOWS
+        // skip this function and captureAndIntern
+        return (int) RtlCaptureStackBackTrace (2, (unsigned long) maxNumFrames, frames, nullptr);
+       #else
+        auto& bounds = getStackBounds ();
+        auto** framePointer = (void**) __builtin_frame_address (0);
+        int numFrames = 0;
+
+        // skip this function's frame: the first recorded return address then leads out of captureAndIntern
+        if (isInside (bounds, framePointer))
+            framePointer = (void**) framePointer[0];
+
+        while (numFrames < maxNumFrames && isInside (bounds, framePointer))
+        {
+            auto* returnAddress = framePointer[1];
+
+            if (returnAddress == nullptr)
+                break;
+
+            frames[numFrames++] = returnAddress;
+
+            auto** next = (void**) framePointer[0];
+
+            // the stack grows downwards, so callers' frames are at higher addresses
+            if (next <= framePointer)
+                break;
+
+            framePointer = next;
+        }
+
+        return numFrames;
+       #endif
+    }
+
+   #if ! JUCE_WINDOWS
+    struct StackBounds
+    {
+        const char* low = nullptr;
+        const char* high = nullptr;
+    };
+
+    static bool isInside (const StackBounds& bounds, void** framePointer) noexcept
+    {
+        auto* address = (const char*) framePointer;
+
+        return address >= bounds.low
+            && address + 2 * sizeof (void*) <= bounds.high
+            && ((pointer_sized_uint) address % sizeof (void*)) == 0;
+    }
+
+    static const StackBounds& getStackBounds () noexcept
+    {
+        thread_local const StackBounds bounds = []
+        {
+            StackBounds result;
+
+           #if JUCE_MAC || JUCE_IOS
+            auto self = pthread_self ();
+            result.high = (const char*) pthread_get_stackaddr_np (self);
+            result.low = result.high - pthread_get_stacksize_np (self);
+           #else
+            pthread_attr_t attributes;
+
+            if (pthread_getattr_np (pthread_self (), &attributes) == 0)
+            {
+                void* address = nullptr;
+                size_t size = 0;
+
+                if (pthread_attr_getstack (&attributes, &address, &size) == 0)
+                {
+                    result.low = (const char*) address;
+                    result.high = result.low + size;
+                }
+
+                pthread_attr_destroy (&attributes);
+            }
+           #endif
+
+            return result;
+        }();
+
+        return bounds;
+    }
+   #endif
+
+    static String symbolicate (void* const* frames, int numFrames)
+    {
+        String result;
+
+       #if JUCE_WINDOWS
+        for (int i = 0; i < numFrames; ++i)
+            result << "    " << i << ": 0x" << String::toHexString ((pointer_sized_int) frames[i]) << newLine;
+       #else
+        if (auto* symbols = backtrace_symbols (frames, numFrames))
+        {
+            for (int i = 0; i < numFrames; ++i)
+                result << "    " << symbols[i] << newLine;
+
+            ::free (symbols);
+        }
+       #endif
+
+        return result;
+    }
+
+    // index 0 counts the objects whose stack didn't fit
+    std::unique_ptr<Stack[]> stacks { new Stack[capacity] };
+
+    JUCE_DECLARE_NON_COPYABLE (StackTable)
+};
+
+//==============================================================================
+template <class OwnerClass>
+class HeavyweightLeakedObjectDetector
+{
+public:
+    HeavyweightLeakedObjectDetector () noexcept                                           { track (); }
+    HeavyweightLeakedObjectDetector (const HeavyweightLeakedObjectDetector&) noexcept     { track (); }
+    HeavyweightLeakedObjectDetector& operator= (const HeavyweightLeakedObjectDetector&) noexcept { return *this; }
+
+    ~HeavyweightLeakedObjectDetector ()
+    {
+        StackTable::getInstance ().objectDeleted (stackIndex);
+    }
+
+private:
+    void track () noexcept
+    {
+        getReporter ();
+
+        auto& table = StackTable::getInstance ();
+        stackIndex = table.captureAndIntern (&classTag);
+        table.objectCreated (stackIndex);
+    }
+
+    /** Prints the creation stacks of this class's leaked objects when the program ends. */
+    struct Reporter
+    {
+        ~Reporter ()
+        {
+            StackTable::getInstance ().reportLeaks (&classTag, OwnerClass::getLeakedObjectClassName ());
+        }
+    };
+
+    static Reporter& getReporter () noexcept
+    {
+        // created after the table, so it is destroyed (and reports) before it
+        StackTable::getInstance ();
+        static Reporter reporter;
+        return reporter;
+    }
+
+    // its address identifies the class in the table
+    static inline const char classTag = 0;
+
+    uint32 stackIndex = StackTable::overflowIndex;
+};
+
+/** Adds the stack tracking to a class that already declares getLeakedObjectClassName (). */
+#define HEAVYWEIGHT_LEAK_DETECTOR_MEMBER(OwnerClass) \
+    friend class HeavyweightLeakedObjectDetector<OwnerClass>; \
+    HeavyweightLeakedObjectDetector<OwnerClass> JUCE_JOIN_MACRO (heavyweightLeakDetector, __LINE__);
+
+#define DECLARE_HEAVYWEIGHT_LEAK_DETECTOR(OwnerClass) \
+    static const char* getLeakedObjectClassName () noexcept { return #OwnerClass; } \
+    HEAVYWEIGHT_LEAK_DETECTOR_MEMBER (OwnerClass)
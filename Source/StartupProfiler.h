@@ -0,0 +1,180 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX || JUCE_ANDROID
+ #include <unistd.h>
+#endif
+
+/**
+ * Startup Profiler
+ *
+ * Before the first frame is on screen, a lot happens that no breakpoint shows
+ * in order: header-level statics are constructed, JUCE
+ * starts up, initialise () builds the MainWindow, which builds the
+ * MainComponent, which is laid out and finally painted.
+ *
+ * StartupProfiler::mark () records when each of these milestones is reached
+ * for the first time (later marks of the same milestone are ignored):
+ *
+ * void MainComponent::resized ()
+ * {
+ *     StartupProfiler::mark (StartupProfiler::firstResized);
+ *     ...
+ * }
+ *
+ * Main.cpp marks static initialisation while its own statics are
+ * initialised. The order in which files' statics are initialised is
+ * unspecified, so some may come before the mark and some after it. Once the
+ * first paint is marked, the breakdown is written to the log, and as JSON to
+ * the file named by the STARTUP_PROFILE_PATH environment variable, if it is
+ * set. This happens from the message loop, so the first paint doesn't wait
+ * for the file system. On Linux the time from process start is included as
+ * well (with the 10 ms resolution of /proc/self/stat); elsewhere times count
+ * from the first milestone.
+ *
+ * A mark is a comparison and, the first time, a clock read. Marks are for the
+ * message thread.
+ */
+
+class StartupProfiler
+{
+public:
+    enum Milestone
+    {
+        staticInitialisation,
+        initialiseCalled,
+        mainComponentConstructed,
+        windowConstructed,
+        firstResized,
+        firstPaint,
+        numMilestones
+    };
+
+    static void mark (Milestone milestone) noexcept
+    {
+        if (times[milestone] > 0.0)
+            return;
+
+        times[milestone] = Time::getMillisecondCounterHiRes ();
+
+        if (milestone == firstPaint)
+            MessageManager::callAsync ([] { report (); });
+    }
+
+    static bool hasReached (Milestone milestone) noexcept     { return times[milestone] > 0.0; }
+
+    static const char* getName (Milestone milestone) noexcept
+    {
+        static const char* const names[] = { "static initialisation", "initialise ()", "MainComponent constructed",
+                                              "MainWindow constructed", "first resized ()", "first paint ()" };
+        static_assert (numElementsInArray (names) == numMilestones, "one name per milestone");
+
+        return names[milestone];
+    }
+
+    /** The milestones reached so far, in milliseconds since process start (or since the first milestone). */
+    static String getBreakdown ()
+    {
+        auto origin = getOrigin ();
+        auto previous = origin;
+
+        String text;
+        text << "Startup breakdown (ms since " << (origin < getFirstMarkTime () ? "process start" : "the first milestone") << ")" << newLine;
+
+        for (auto milestone : getReachedMilestones ())
+        {
+            text << "  " << String (getName (milestone)).paddedRight (' ', 28)
+                 << String (times[milestone] - origin, 2).paddedLeft (' ', 10)
+                 << "  (+" << String (times[milestone] - previous, 2) << ")" << newLine;
+
+            previous = times[milestone];
+        }
+
+        return text;
+    }
+
+    static String toJson ()
+    {
+        auto origin = getOrigin ();
+
+        String json;
+        json << "{\"project\":\"" << ProjectInfo::projectName << "\",\"version\":\"" << ProjectInfo::versionString
+             << "\",\"fromProcessStart\":" << (origin < getFirstMarkTime () ? "true" : "false") << ",\"milestones\":[";
+
+        auto first = true;
+
+        for (auto milestone : getReachedMilestones ())
+        {
+            json << (first ? "\n" : ",\n") << "{\"name\":\"" << getName (milestone) << "\",\"ms\":" << String (times[milestone] - origin, 3) << "}";
+            first = false;
+        }
+
+        json << "\n]}\n";
+        return json;
+    }
+
+private:
+    /** In the order they were reached (MainComponent's first resized () comes before its constructor returns, for example). */
+    static std::vector<Milestone> getReachedMilestones ()
+    {
+        std::vector<Milestone> reached;
+
+        for (int i = 0; i < numMilestones; ++i)
+            if (hasReached ((Milestone) i))
+                reached.push_back ((Milestone) i);
+
+        std::stable_sort (reached.begin (), reached.end (), [] (Milestone a, Milestone b) { return times[a] < times[b]; });
+        return reached;
+    }
+
+    static void report ()
+    {
+        Logger::writeToLog (getBreakdown ());
+
+        auto path = SystemStats::getEnvironmentVariable ("STARTUP_PROFILE_PATH", {});
+
+        if (path.isNotEmpty ())
+            File::getCurrentWorkingDirectory ().getChildFile (path).replaceWithText (toJson ());
+    }
+
+    /** When the first milestone was reached (static initialisation, unless nothing marked it). */
+    static double getFirstMarkTime ()
+    {
+        auto reached = getReachedMilestones ();
+        return reached.empty () ? 0.0 : times[reached.front ()];
+    }
+
+    /** When the process started, on the Time::getMillisecondCounterHiRes () scale, or the first milestone if unknown. */
+    static double getOrigin ()
+    {
+        auto firstMarkTime = getFirstMarkTime ();
+        auto processAge = getProcessAgeMilliseconds ();
+
+        if (processAge <= 0.0)
+            return firstMarkTime;
+
+        return jmin (firstMarkTime, Time::getMillisecondCounterHiRes () - processAge);
+    }
+
+    static double getProcessAgeMilliseconds ()
+    {
+       #if JUCE_LINUX || JUCE_ANDROID
+        // field 22 of /proc/self/stat is the start time in clock ticks since boot; the name in field 2 may contain spaces
+        auto stat = File ("/proc/self/stat").loadFileAsString ();
+        auto fields = StringArray::fromTokens (stat.fromLastOccurrenceOf (")", false, false), true);
+        auto uptimeSeconds = File ("/proc/uptime").loadFileAsString ().getDoubleValue ();
+
+        if (fields.size () < 20 || uptimeSeconds <= 0.0)
+            return 0.0;
+
+        auto startSeconds = (double) fields[19].getLargeIntValue () / (double) sysconf (_SC_CLK_TCK);
+        return (uptimeSeconds - startSeconds) * 1000.0;
+       #else
+        return 0.0;
+       #endif
+    }
+
+    // constant initialised, so that it is all zeros before any static is dynamically initialised
+    static inline double times[numMilestones] = {};
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "InplaceFunction.h"
+
+/**
+ * Timing Wheel
+ *
+ * A hierarchical timing wheel stores pending callbacks in buckets instead of
+ * a sorted list: level 0 has one bucket per millisecond for the next 64 ms,
+ * level 1 one bucket per 64 ms for the next ~4 s, and so on. Scheduling and
+ * cancelling are O(1) (link/unlink in a bucket), and every tick fires a
+ * whole bucket at once. Entries in the higher levels are moved down a level
+ * ("cascaded") when the lower level wraps around.
+ *
+ * The wheel itself knows nothing about real time - it is moved forward with
+ * advanceTo (). LifetimeScheduler drives it from a single juce::Timer.
+ *
+ * All entries live in one vector and are linked by index, so a Handle is just
+ * an index and a generation (like a SlotReference) and stays cheap to copy.
+ * Callbacks are InplaceFunctions, stored inside the entries, so scheduling
+ * doesn't allocate once the vector has grown. Not thread safe.
+ */
+
+class TimingWheel
+{
+public:
+    using Callback = InplaceFunction<void(), 48>;
+
+    struct Handle
+    {
+        uint32 index = invalidIndex;
+        uint32 generation = 0;
+
+        bool isValid () const noexcept { return index != invalidIndex; }
+    };
+
+    explicit TimingWheel (int64 startTime = 0) : now (startTime)
+    {
+        for (auto& level : buckets)
+            std::fill (std::begin (level), std::end (level), invalidIndex);
+    }
+
+    /** Schedules the callback for the given time. Times in the past fire on the next tick. */
+    Handle schedule (int64 dueTime, Callback callback)
+    {
+        auto index = allocateEntry ();
+        auto& entry = entries[index];
+
+        entry.dueTime = jmax (dueTime, now + 1);
+        entry.callback = std::move (callback);
+        link (index);
+
+        ++numPending;
+        return { index, entry.generation };
+    }
+
+    /** Removes a pending callback. Returns false if it already fired or was cancelled. */
+    bool cancel (Handle handle) noexcept
+    {
+        if (! isPending (handle))
+            return false;
+
+        unlink (handle.index);
+        freeEntry (handle.index);
+        --numPending;
+        return true;
+    }
+
+    bool isPending (Handle handle) const noexcept
+    {
+        return handle.index < entries.size ()
+            && entries[handle.index].generation == handle.generation
+            && entries[handle.index].isLinked;
+    }
+
+    /** Fires everything that is due up to and including the given time. Returns the number of callbacks fired. */
+    int advanceTo (int64 time)
+    {
+        int numFired = 0;
+
+        while (now < time)
+        {
+            if (numPending == 0)
+            {
+                now = time;
+                break;
+            }
+
+            ++now;
+            auto index = (int) (now & slotMask);
+
+            if (index == 0)
+                for (int level = 1; level < numLevels && cascade (level) == 0; ++level)
+                {}
+
+            auto& bucket = buckets[0][index];
+
+            while (bucket != invalidIndex)
+            {
+                auto entryIndex = bucket;
+                unlink (entryIndex);
+
+                auto callback = std::move (entries[entryIndex].callback);
+                freeEntry (entryIndex);
+                --numPending;
+
+                // may schedule or cancel other entries
+                callback ();
+                ++numFired;
+            }
+        }
+
+        return numFired;
+    }
+
+    int64 getCurrentTime () const noexcept     { return now; }
+    size_t getNumPending () const noexcept     { return numPending; }
+    bool isEmpty () const noexcept             { return numPending == 0; }
+
+    /** Moves the wheel to a new time base. Only allowed while nothing is pending. */
+    void reset (int64 time) noexcept
+    {
+        jassert (isEmpty ());
+        now = time;
+    }
+
+    /** Drops all pending callbacks without calling them. */
+    void clear ()
+    {
+        for (uint32 i = 0; i < entries.size (); ++i)
+        {
+            if (entries[i].isLinked)
+            {
+                unlink (i);
+                freeEntry (i);
+            }
+        }
+
+        numPending = 0;
+    }
+
+    static constexpr uint32 invalidIndex = 0xffffffff;
+
+private:
+    static constexpr int bitsPerLevel = 6;
+    static constexpr int slotsPerLevel = 1 << bitsPerLevel;
+    static constexpr int64 slotMask = slotsPerLevel - 1;
+    static constexpr int numLevels = 4;
+    static constexpr int64 maxDelay = ((int64) 1 << (bitsPerLevel * numLevels)) - 1;
+
+    struct Entry
+    {
+        int64 dueTime = 0;
+        Callback callback;
+        uint32 generation = 1;
+        uint32 previous = invalidIndex;
+        uint32 next = invalidIndex;
+        uint8 level = 0;
+        uint8 slot = 0;
+        bool isLinked = false;
+    };
+
+    uint32 allocateEntry ()
+    {
+        if (firstFree == invalidIndex)
+        {
+            entries.emplace_back ();
+            return (uint32) entries.size () - 1;
+        }
+
+        auto index = firstFree;
+        firstFree = entries[index].next;
+        entries[index].next = invalidIndex;
+        return index;
+    }
+
+    void freeEntry (uint32 index) noexcept
+    {
+        auto& entry = entries[index];
+        entry.callback = nullptr;
+        ++entry.generation;
+        entry.next = firstFree;
+        firstFree = index;
+    }
+
+    void link (uint32 index) noexcept
+    {
+        auto& entry = entries[index];
+
+        // beyond the top level: park it in the furthest bucket, it'll be re-linked on cascade
+        auto delta = jmin (entry.dueTime - now, maxDelay);
+        auto placementTime = now + delta;
+
+        int level = 0;
+
+        while (level < numLevels - 1 && delta >= ((int64) 1 << (bitsPerLevel * (level + 1))))
+            ++level;
+
+        entry.level = (uint8) level;
+        entry.slot = (uint8) ((placementTime >> (bitsPerLevel * level)) & slotMask);
+        entry.isLinked = true;
+
+        auto& head = buckets[level][entry.slot];
+        entry.previous = invalidIndex;
+        entry.next = head;
+
+        if (head != invalidIndex)
+            entries[head].previous = index;
+
+        head = index;
+    }
+
+    void unlink (uint32 index) noexcept
+    {
+        auto& entry = entries[index];
+
+        if (entry.previous != invalidIndex)
+            entries[entry.previous].next = entry.next;
+        else
+            buckets[entry.level][entry.slot] = entry.next;
+
+        if (entry.next != invalidIndex)
+            entries[entry.next].previous = entry.previous;
+
+        entry.previous = invalidIndex;
+        entry.next = invalidIndex;
+        entry.isLinked = false;
+    }
+
+    /** Moves one bucket of a higher level down. Returns that bucket's slot index. */
+    int cascade (int level) noexcept
+    {
+        auto slot = (int) ((now >> (bitsPerLevel * level)) & slotMask);
+        auto index = std::exchange (buckets[level][slot], invalidIndex);
+
+        while (index != invalidIndex)
+        {
+            auto next = entries[index].next;
+            entries[index].isLinked = false;
+            link (index);
+            index = next;
+        }
+
+        return slot;
+    }
+
+    std::vector<Entry> entries;
+    uint32 buckets[numLevels][slotsPerLevel];
+    uint32 firstFree = invalidIndex;
+    size_t numPending = 0;
+    int64 now;
+
+    JUCE_DECLARE_NON_COPYABLE (TimingWheel)
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * Weak Callbacks
+ *
+ * Calling a member function later, but only if the object still exists, is
+ * usually written by hand:
+ *
+ * [weak = WeakReference<Thing> (thing)] { if (weak) weak->update (); }
+ *
+ * weakCallback () writes that lambda for you:
+ *
+ * auto callback = weakCallback (thing, &Thing::update);
+ * callback ();        // calls thing->update (), or does nothing once thing is deleted
+ *
+ * auto withFallback = weakCallback (thing, &Thing::update).orElse ([] { DBG ("gone"); });
+ *
+ * The weak reference is a Thing::WeakRef if the class declares one (like
+ * NamedLifetimeObject does), and a juce::WeakReference<Thing> otherwise.
+ * Arguments are passed on to the method, and its result is discarded.
+ *
+ * The callable stores just the reference, the member function pointer and
+ * the fallback, inline - creating and copying it never allocates. Whether
+ * storing it in a std::function allocates depends on the standard library
+ * (libstdc++ does for anything that isn't trivially copyable), so keep it in
+ * an InplaceFunction instead, like MainComponent does for its check button:
+ *
+ * InplaceFunction<void()> checkAction = weakCallback (thing, &Thing::update);
+ */
+
+template <class ObjectType, class = void>
+struct WeakReferenceTypeFor
+{
+    using Type = WeakReference<ObjectType>;
+};
+
+template <class ObjectType>
+struct WeakReferenceTypeFor<ObjectType, std::void_t<typename ObjectType::WeakRef>>
+{
+    using Type = typename ObjectType::WeakRef;
+};
+
+/** Does nothing; the default fallback of a WeakCallback. */
+struct NoWeakCallbackFallback
+{
+    template <typename... Args>
+    void operator() (Args&&...) const noexcept {}
+};
+
+template <class ReferenceType, class MemberFunction, class Fallback = NoWeakCallbackFallback>
+class WeakCallback
+{
+public:
+    WeakCallback (ReferenceType targetReference, MemberFunction methodToCall, Fallback fallbackToCall = {})
+        : target (std::move (targetReference)), method (methodToCall), fallback (std::move (fallbackToCall)) {}
+
+    template <typename... Args>
+    void operator() (Args&&... args) const
+    {
+        if (auto* object = target.get ())
+            (object->*method) (std::forward<Args> (args)...);
+        else
+            fallback (std::forward<Args> (args)...);
+    }
+
+    /** Returns a copy that calls newFallback (with the same arguments) when the object is gone. */
+    template <class NewFallback>
+    WeakCallback<ReferenceType, MemberFunction, NewFallback> orElse (NewFallback newFallback) const
+    {
+        return { target, method, std::move (newFallback) };
+    }
+
+    bool isTargetAlive () const noexcept   { return target.get () != nullptr; }
+
+private:
+    ReferenceType target;
+    MemberFunction method;
+    Fallback fallback;
+};
+
+template <class ObjectType, class MemberFunction>
+auto weakCallback (ObjectType* object, MemberFunction method)
+{
+    static_assert (std::is_member_function_pointer_v<MemberFunction>, "weakCallback needs a pointer to a member function");
+
+    using ReferenceType = typename WeakReferenceTypeFor<ObjectType>::Type;
+    return WeakCallback<ReferenceType, MemberFunction> (ReferenceType (object), method);
+}